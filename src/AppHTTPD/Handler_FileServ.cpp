@@ -1,13 +1,21 @@
 #include "Handler_FileServ.hpp"
 
+#include <list>
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_system.h"
 
 #include "esp_http_server.h"
 
+#include "rom/md5_hash.h"
+
 #include "ZWUtils.hpp"
 #include "ZWAppConfig.h"
 
@@ -24,6 +32,8 @@ inline constexpr char TAG[] = "HTTPD-FS";
 inline constexpr char URI_PATTERN[] = "/*";
 #define URI_PATH_DELIM '/'
 #define URI_EXT_DELIM '.'
+#define URI_QUERY_DELIM '?'
+#define URI_FINGERPRINT_LEN 8
 
 inline constexpr char URI_DEFAULT_FILENAME[] = "index.html";
 inline constexpr char URI_SCHEME_SEP[] = "http://";
@@ -37,8 +47,17 @@ inline constexpr char HTTP_HEADER_LOCATION[] = "Location";
 inline constexpr char HTTP_HEADER_ETAG[] = "ETag";
 inline constexpr char HTTP_HEADER_IF_NONE_MATCH[] = "If-None-Match";
 inline constexpr char HTTP_HEADER_CONTENT_ENCODING[] = "Content-Encoding";
+inline constexpr char HTTP_HEADER_ACCEPT_RANGES[] = "Accept-Ranges";
+
+inline constexpr char HTTP_ACCEPT_RANGES_BYTES[] = "bytes";
 
 inline constexpr char HTTP_CACHE_CONTROL_VALUE[] = "max-age=0, must-revalidate";
+inline constexpr char HTTP_CACHE_CONTROL_IMMUTABLE[] = "max-age=31536000, immutable";
+
+// A query parameter carrying the version of the requested file.
+inline constexpr char URI_PARAM_VERSION[] = "v";
+// A fingerprint in a file name follows either of these.
+inline constexpr char URI_FINGERPRINT_DELIMS[] = "-.";
 
 inline constexpr char HTTP_MIME_BINARY[] = "application/octet-stream";
 inline constexpr char HTTP_MIME_TEXT[] = "text/plain";
@@ -62,6 +81,16 @@ inline constexpr char HTTP_MIME_XHTML[] = "application/xhtml+xml";
 inline constexpr char SERVE_AS_GZ_SUFFIX[] = "._serve_as_.gz";
 inline constexpr char CONTENT_ENCODING_GZIP[] = "gzip";
 
+// Beyond this many files, the index is partial and misses are looked up in the file system.
+#define ASSET_INDEX_MAX_ENTRIES 256
+
+// Files no larger than this are cached in RAM.
+#define ASSET_CACHE_MAX_FILE_SIZE 4096
+// Total size of the cached files.
+#define ASSET_CACHE_CAPACITY 16384
+// Files are only cached while the free heap stays above this.
+#define ASSET_CACHE_MIN_FREE_HEAP 12288
+
 #define INFER_TYPE_FROM_EXT(ext, type, type_ext) \
   if (strcmp(ext, type_ext) == 0) return HTTP_MIME_##type
 
@@ -92,6 +121,259 @@ const char* _uri_infer_mimetype(const char* uri) {
   return HTTP_MIME_BINARY;
 }
 
+struct AssetEntry {
+  const char* mime_type;
+  size_t size;
+  bool serve_as_gz;
+  // Weak (size and mtime based) until the content is hashed.
+  bool content_etag;
+  char etag[20];
+};
+
+AssetEntry _make_asset_entry(const char* uri, const struct stat& st, bool serve_as_gz) {
+  AssetEntry entry = {
+      .mime_type = _uri_infer_mimetype(uri),
+      .size = (size_t)st.st_size,
+      .serve_as_gz = serve_as_gz,
+  };
+  snprintf(entry.etag, sizeof(entry.etag), "W/\"%06lX:%08lX\"", st.st_size & 0xffffff,
+           st.st_mtime);
+  return entry;
+}
+
+// Replace the ETag of `entry` with a strong one, derived from the digest of the file content.
+esp_err_t _hash_asset_etag(FILE* file, AssetEntry& entry) {
+  MD5Context md5_context;
+  MD5Init(&md5_context);
+  char buf[256];
+  while (size_t read_len = fread(buf, 1, sizeof(buf), file)) {
+    MD5Update(&md5_context, (const unsigned char*)buf, read_len);
+  }
+  if (ferror(file)) return ESP_FAIL;
+  rewind(file);
+
+  unsigned char digest[16];
+  MD5Final(digest, &md5_context);
+  // Half of the digest is plenty to tell versions of the same file apart.
+  char* etag = entry.etag;
+  *etag++ = '"';
+  for (int i = 0; i < 8; i++) etag += sprintf(etag, "%02x", digest[i]);
+  strcpy(etag, "\"");
+  entry.content_etag = true;
+  return ESP_OK;
+}
+
+// Whether the URI refers to a specific version of a file, which therefore never changes.
+// That is, either the file name carries a content hash of `URI_FINGERPRINT_LEN` hex digits
+// (e.g. `app.3f2a9c1b.js`), or the version parameter of the query matches the content
+// ETag (e.g. `zw_base.js?v=<digest>`). Anything else is revalidated by ETag.
+bool _uri_fingerprinted(const char* path, const char* query, const AssetEntry& asset) {
+  if (query != nullptr && asset.content_etag) {
+    auto version = query_parse_param(query, URI_PARAM_VERSION);
+    // The content ETag is the quoted digest.
+    if (version && version->length() + 2 == strlen(asset.etag) &&
+        strncmp(asset.etag + 1, version->c_str(), version->length()) == 0) {
+      return true;
+    }
+  }
+  const char* segment = strrchr(path, URI_PATH_DELIM);
+  while ((segment = strpbrk(segment + 1, URI_FINGERPRINT_DELIMS)) != nullptr) {
+    size_t len = 0;
+    while (isxdigit(segment[len + 1])) ++len;
+    if (len == URI_FINGERPRINT_LEN && segment[len + 1] == URI_EXT_DELIM) return true;
+  }
+  return false;
+}
+
+// An index of the files under `root_dir`, keyed by request URI.
+//
+// Note that the HTTP server handles all requests on a single task, so the index
+// is never accessed concurrently, and needs no locking.
+class AssetIndex {
+ public:
+  bool built(void) const { return built_; }
+  // Whether all files are indexed, so that a miss means the file does not exist.
+  bool complete(void) const { return complete_; }
+
+  void Build(const std::string& root_dir);
+  void Invalidate(void) {
+    entries_.clear();
+    built_ = false;
+  }
+
+  AssetEntry* Find(const std::string& uri) {
+    auto iter = entries_.find(uri);
+    return (iter != entries_.end()) ? &iter->second : nullptr;
+  }
+
+ private:
+  bool _Add(std::string&& uri, const struct stat& st);
+
+  std::unordered_map<std::string, AssetEntry> entries_;
+  bool built_ = false;
+  bool complete_ = false;
+};
+
+bool AssetIndex::_Add(std::string&& uri, const struct stat& st) {
+  bool serve_as_gz = false;
+  if (uri.length() > utils::STRLEN(SERVE_AS_GZ_SUFFIX) &&
+      uri.compare(uri.length() - utils::STRLEN(SERVE_AS_GZ_SUFFIX), std::string::npos,
+                  SERVE_AS_GZ_SUFFIX) == 0) {
+    uri.resize(uri.length() - utils::STRLEN(SERVE_AS_GZ_SUFFIX));
+    serve_as_gz = true;
+  }
+
+  auto iter = entries_.find(uri);
+  if (iter != entries_.end()) {
+    // The compressed variant takes precedence.
+    if (serve_as_gz) iter->second = _make_asset_entry(uri.c_str(), st, true);
+    return true;
+  }
+  if (entries_.size() >= ASSET_INDEX_MAX_ENTRIES) return false;
+  AssetEntry entry = _make_asset_entry(uri.c_str(), st, serve_as_gz);
+  entries_.emplace(std::move(uri), entry);
+  return true;
+}
+
+void AssetIndex::Build(const std::string& root_dir) {
+  entries_.clear();
+  built_ = complete_ = true;
+
+  // Directories pending scan, relative to `root_dir` (with leading delimiter).
+  std::vector<std::string> pending_dirs(1);
+  while (!pending_dirs.empty() && complete_) {
+    std::string dir_uri = std::move(pending_dirs.back());
+    pending_dirs.pop_back();
+
+    std::string dir_path = root_dir + dir_uri;
+    utils::AutoReleaseRes<DIR*> dir(opendir(dir_path.c_str()), [](DIR* dir) {
+      if (dir) closedir(dir);
+    });
+    if (*dir == NULL) {
+      ESP_LOGW(TAG, "Unable to scan '%s'", dir_path.c_str());
+      complete_ = false;
+      break;
+    }
+    while (struct dirent* dir_entry = readdir(*dir)) {
+      if (strcmp(dir_entry->d_name, ".") == 0 || strcmp(dir_entry->d_name, "..") == 0) continue;
+
+      std::string uri = dir_uri;
+      uri.append(1, URI_PATH_DELIM).append(dir_entry->d_name);
+      struct stat st;
+      if (stat((root_dir + uri).c_str(), &st) != 0) continue;
+      if (S_ISDIR(st.st_mode)) {
+        pending_dirs.push_back(std::move(uri));
+      } else if (S_ISREG(st.st_mode) && !_Add(std::move(uri), st) && complete_) {
+        // Finish this directory still, so that the indexed files pick up their compressed
+        // variants, which are always siblings.
+        ESP_LOGW(TAG, "Index full at %d files, the rest are looked up per request",
+                 ASSET_INDEX_MAX_ENTRIES);
+        complete_ = false;
+      }
+    }
+  }
+  ESP_LOGI(TAG, "Indexed %d files%s", entries_.size(), complete_ ? "" : " (partial)");
+}
+
+AssetIndex asset_index_;
+
+#ifdef ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+
+// A least-recently-used cache of small file contents, keyed by URI and validated by ETag.
+// It only ever holds a handful of entries, so a linear scan is cheaper than another map.
+class AssetCache {
+ public:
+  const AssetCacheStats& stats(void) const { return stats_; }
+
+  // Returns the cached contents, or nullptr on a miss.
+  const std::string* Find(const std::string& uri, const char* etag) {
+    for (auto iter = entries_.begin(); iter != entries_.end(); ++iter) {
+      if (iter->uri != uri) continue;
+      if (strcmp(iter->etag, etag) != 0) {
+        // Stale contents
+        _Erase(iter);
+        break;
+      }
+      entries_.splice(entries_.begin(), entries_, iter);
+      ++stats_.hits;
+      return &entries_.front().data;
+    }
+    ++stats_.misses;
+    return nullptr;
+  }
+
+  void Insert(const std::string& uri, const char* etag, std::string&& data) {
+    // Check the heap first, so that nothing is evicted for an entry that is not added.
+    if (esp_get_free_heap_size() < ASSET_CACHE_MIN_FREE_HEAP) return;
+    while (!entries_.empty() && stats_.bytes + data.size() > ASSET_CACHE_CAPACITY) {
+      _Erase(std::prev(entries_.end()));
+      ++stats_.evictions;
+    }
+
+    stats_.bytes += data.size();
+    entries_.push_front({.uri = uri, .data = std::move(data)});
+    strcpy(entries_.front().etag, etag);
+    stats_.entries = entries_.size();
+  }
+
+  void Clear(void) {
+    entries_.clear();
+    stats_.entries = stats_.bytes = 0;
+  }
+
+ private:
+  struct Entry {
+    std::string uri;
+    std::string data;
+    char etag[sizeof(AssetEntry::etag)];
+  };
+
+  void _Erase(std::list<Entry>::iterator iter) {
+    stats_.bytes -= iter->data.size();
+    entries_.erase(iter);
+    stats_.entries = entries_.size();
+  }
+
+  std::list<Entry> entries_;
+  AssetCacheStats stats_ = {};
+};
+
+AssetCache asset_cache_;
+
+// Send a small file as a whole, and keep it in the cache.
+esp_err_t _send_and_cache(httpd_req_t* req, const std::string& uri, const AssetEntry& asset,
+                          FILE* file) {
+  std::string data(asset.size, '\0');
+  if (fread(&data.front(), 1, asset.size, file) != asset.size) {
+    ESP_LOGW(TAG, "File read short, not caching");
+    rewind(file);
+    return send_file(req, file, asset.size);
+  }
+  ESP_RETURN_ON_ERROR(httpd_resp_send(req, data.data(), data.size()));
+  asset_cache_.Insert(uri, asset.etag, std::move(data));
+  return ESP_OK;
+}
+
+#endif  // ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+
+// Look up a file not in the index; returns its entry, and opens the file.
+utils::DataOrError<AssetEntry> _probe_asset(const char* uri, std::string& file_path,
+                                            utils::AutoReleaseRes<FILE*>& file) {
+  // Check for existence of `._serve_as_.gz`
+  std::string serve_as_gz_path = file_path + SERVE_AS_GZ_SUFFIX;
+  bool serve_as_gz = true;
+  if (*(file = fopen(serve_as_gz_path.c_str(), "r")) == NULL) {
+    serve_as_gz = false;
+    if (*(file = fopen(file_path.c_str(), "r")) == NULL) return ESP_ERR_NOT_FOUND;
+  } else {
+    file_path = std::move(serve_as_gz_path);
+  }
+
+  struct stat st;
+  if (fstat(fileno(*file), &st) != 0) return ESP_FAIL;
+  return _make_asset_entry(uri, st, serve_as_gz);
+}
+
 #ifdef ZW_APPLIANCE_COMPONENT_NET_CAPTIVE_DNS
 
 esp_err_t _captive_redirect(httpd_req_t* req, bool& redirected) {
@@ -130,10 +412,10 @@ esp_err_t _handler_fileserv(httpd_req_t* req) {
                                "HTTP service `root_dir` not configured");
   }
 
-  std::string file_path;
-  const char* mime_type;
+  std::string uri = req->uri;
+  const char* query = strchr(req->uri, URI_QUERY_DELIM);
+  if (query != nullptr) uri.resize(query - req->uri);
   {
-    std::string uri = req->uri;
     if (uri.empty()) {
       uri += URI_PATH_DELIM;
     } else if (uri.front() != URI_PATH_DELIM) {
@@ -149,30 +431,50 @@ esp_err_t _handler_fileserv(httpd_req_t* req) {
     }
 
     if (uri.back() == URI_PATH_DELIM) uri.append(URI_DEFAULT_FILENAME);
-    file_path = httpd_config_.root_dir + uri;
-    mime_type = _uri_infer_mimetype(uri.c_str());
   }
 
+  if (!asset_index_.built()) asset_index_.Build(httpd_config_.root_dir);
+
+  std::string file_path = httpd_config_.root_dir + uri;
   utils::AutoReleaseRes<FILE*> file(NULL, [](FILE* file) {
     if (file) fclose(file);
   });
-  // Check for existence of `._serve_as_.gz`
-  std::string serve_as_gz_path = file_path + SERVE_AS_GZ_SUFFIX;
-  if (*(file = fopen(serve_as_gz_path.c_str(), "r")) == NULL) {
-    serve_as_gz_path.clear();
-    if (*(file = fopen(file_path.c_str(), "r")) == NULL) {
+  AssetEntry asset;
+  const std::string* cached = nullptr;
+#ifdef ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+  bool cacheable = false;
+#endif
+  if (AssetEntry* indexed = asset_index_.Find(uri)) {
+    if (indexed->serve_as_gz) file_path.append(SERVE_AS_GZ_SUFFIX);
+#ifdef ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+    cacheable = indexed->size <= ASSET_CACHE_MAX_FILE_SIZE;
+    if (cacheable) cached = asset_cache_.Find(uri, indexed->etag);
+#endif
+    if (cached == nullptr && *(file = fopen(file_path.c_str(), "r")) == NULL) {
+      // The file was changed behind our back, so may be others.
+      fileserv_invalidate_index();
       return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unable to open file");
     }
+    // Hashed once per file, and remembered until the index is rebuilt.
+    if (!indexed->content_etag && _hash_asset_etag(*file, *indexed) != ESP_OK) {
+      return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read file");
+    }
+    asset = *indexed;
+  } else if (asset_index_.complete()) {
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unable to open file");
+  } else {
+    auto probed = _probe_asset(uri.c_str(), file_path, file);
+    if (!probed) {
+      if (probed.error() == ESP_ERR_NOT_FOUND) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unable to open file");
+      }
+      return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                                 "Failed to query file stat");
+    }
+    asset = *probed;
   }
-  ESP_LOGI(TAG, "%s -> %s", req->uri,
-           serve_as_gz_path.empty() ? file_path.c_str() : serve_as_gz_path.c_str());
-
-  struct stat st;
-  if (fstat(fileno(*file), &st) != 0) {
-    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to query file stat");
-  }
-  utils::DataBuf etag_buf(16);
-  const char* etag = etag_buf.PrintTo("%06lX:%08lX", st.st_size & 0xffffff, st.st_mtime);
+  ESP_LOGI(TAG, "%s -> %s%s", req->uri, file_path.c_str(), cached ? " (cached)" : "");
+  const char* etag = asset.etag;
 
   do {
     std::string check_etag(httpd_req_get_hdr_value_len(req, HTTP_HEADER_IF_NONE_MATCH), '\0');
@@ -186,21 +488,62 @@ esp_err_t _handler_fileserv(httpd_req_t* req) {
     }
   } while (0);
 
-  ESP_LOGD(TAG, "Serving %ld bytes (%s)...", st.st_size, mime_type);
-  ESP_RETURN_ON_ERROR(httpd_resp_set_type(req, mime_type));
-  ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req, HTTP_HEADER_CACHE_CONTROL, HTTP_CACHE_CONTROL_VALUE));
+  // Note that for gzip served assets, the range applies to the encoded content.
+  auto range = resolve_range(req, asset.size, etag);
+  if (!range) return send_range_not_satisfiable(req, asset.size);
+
+  ESP_LOGD(TAG, "Serving %d of %d bytes (%s)...", range->length, asset.size, asset.mime_type);
+  ESP_RETURN_ON_ERROR(httpd_resp_set_type(req, asset.mime_type));
+  ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req, HTTP_HEADER_CACHE_CONTROL,
+                                         _uri_fingerprinted(uri.c_str(), query, asset)
+                                             ? HTTP_CACHE_CONTROL_IMMUTABLE
+                                             : HTTP_CACHE_CONTROL_VALUE));
   ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req, HTTP_HEADER_ETAG, etag));
-  if (!serve_as_gz_path.empty()) {
+  ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req, HTTP_HEADER_ACCEPT_RANGES, HTTP_ACCEPT_RANGES_BYTES));
+  if (asset.serve_as_gz) {
     ESP_RETURN_ON_ERROR(
         httpd_resp_set_hdr(req, HTTP_HEADER_CONTENT_ENCODING, CONTENT_ENCODING_GZIP));
   }
-  return send_file(req, *file, st.st_size);
+  if (cached != nullptr) {
+    if (!range->partial) return httpd_resp_send(req, cached->data(), cached->size());
+    const char* data = cached->data() + range->start;
+    return send_body(
+        req, asset.size,
+        [&data](char* buf, size_t len) {
+          memcpy(buf, data, len);
+          data += len;
+          return len;
+        },
+        *range);
+  }
+#ifdef ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+  if (cacheable && !range->partial) return _send_and_cache(req, uri, asset, *file);
+#endif
+  return send_file(req, *file, asset.size, *range);
 }
 
 }  // namespace
 
+void fileserv_invalidate_index(void) {
+  asset_index_.Invalidate();
+#ifdef ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+  asset_cache_.Clear();
+#endif
+}
+
+AssetCacheStats fileserv_cache_stats(void) {
+#ifdef ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+  return asset_cache_.stats();
+#else
+  return {};
+#endif
+}
+
 esp_err_t register_handler_fileserv(httpd_handle_t httpd) {
   ESP_LOGD(TAG, "Register handler on %s", URI_PATTERN);
+  if (!serving_config().httpd.root_dir.empty()) {
+    asset_index_.Build(serving_config().httpd.root_dir);
+  }
   httpd_uri_t handler = {
       .uri = URI_PATTERN,
       .method = HTTP_GET,
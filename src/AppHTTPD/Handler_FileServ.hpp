@@ -6,6 +6,9 @@
 // If the module offers features for external used, it will put
 // them in the `Interface.h`.
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "esp_err.h"
 
 #include "esp_http_server.h"
@@ -16,4 +19,19 @@ namespace zw::esp8266::app::httpd {
 // This handler should be registered the last since it captures the root.
 esp_err_t register_handler_fileserv(httpd_handle_t httpd);
 
+// Drop the index of served files, which will be rebuilt on the next request.
+// Must be called from the HTTP server task, whenever files may have been changed.
+void fileserv_invalidate_index(void);
+
+struct AssetCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  size_t entries;
+  size_t bytes;
+};
+
+// Counters of the in-RAM cache of small served files.
+AssetCacheStats fileserv_cache_stats(void);
+
 }  // namespace zw::esp8266::app::httpd
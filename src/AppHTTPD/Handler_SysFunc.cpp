@@ -1,7 +1,9 @@
 #include "Handler_SysFunc.hpp"
 
+#include <algorithm>
 #include <string>
 #include <vector>
+#include <string.h>
 
 #include "cJSON.h"
 
@@ -28,6 +30,9 @@
 #include "Handler_SysFunc_OTA.hpp"
 #endif
 #include "Handler_SysFunc_Config.hpp"
+#ifdef ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+#include "Handler_FileServ.hpp"
+#endif
 
 namespace zw::esp8266::app::httpd {
 namespace {
@@ -128,7 +133,6 @@ inline constexpr char TYPE_USER[] = "user";
 inline constexpr char TYPE_SYSTEM[] = "system";
 
 inline constexpr char HTTP_MIME_BINARY[] = "application/octet-stream";
-inline constexpr char HTTP_HEADER_CONTENT_LENGTH[] = "Content-Length";
 inline constexpr char HTTP_HEADER_CONTENT_DISPOSITION[] = "Content-Disposition";
 inline constexpr char HTTP_HEADER_CONTENT_DISPOSITION_VALUE_TMPL[] =
     "attachment; filename=\"" _ZW_APPLIANCE_NAME "_%d.littlefs\"";
@@ -162,9 +166,6 @@ esp_err_t _storage_dump(httpd_req_t* req, const std::string& type) {
     return ESP_OK;
   }
 
-  char size_buf[10];
-  snprintf(size_buf, 10, "%d", accessor->sectors() * SPI_FLASH_SEC_SIZE);
-  ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req, HTTP_HEADER_CONTENT_LENGTH, size_buf));
   ESP_RETURN_ON_ERROR(httpd_resp_set_type(req, HTTP_MIME_BINARY));
 
   struct timeval tv;
@@ -174,12 +175,24 @@ esp_err_t _storage_dump(httpd_req_t* req, const std::string& type) {
       httpd_resp_set_hdr(req, HTTP_HEADER_CONTENT_DISPOSITION,
                          filename.PrintTo(HTTP_HEADER_CONTENT_DISPOSITION_VALUE_TMPL, tv.tv_sec)));
 
-  utils::DataBuf data(SPI_FLASH_SEC_SIZE);
-  for (size_t idx = 0; idx < accessor->sectors(); idx++) {
-    ESP_RETURN_ON_ERROR(accessor->read_sector(idx, data.data()));
-    ESP_RETURN_ON_ERROR(httpd_resp_send_chunk(req, (const char*)data.data(), SPI_FLASH_SEC_SIZE));
-  }
-  return httpd_resp_send_chunk(req, NULL, 0);
+  // The dump has no validator; resuming assumes the partition has not changed in between.
+  const size_t size = accessor->sectors() * SPI_FLASH_SEC_SIZE;
+  auto range = resolve_range(req, size, nullptr);
+  if (!range) return send_range_not_satisfiable(req, size);
+
+  // The body is read in whole sectors, only the first one may be partially sent.
+  size_t pos = range->start;
+  return send_body(
+      req, size,
+      [&](char* buf, size_t len) {
+        if (accessor->read_sector(pos / SPI_FLASH_SEC_SIZE, buf) != ESP_OK) return (size_t)0;
+        const size_t offset = pos % SPI_FLASH_SEC_SIZE;
+        len = std::min(len, SPI_FLASH_SEC_SIZE - offset);
+        if (offset) memmove(buf, buf + offset, len);
+        pos += len;
+        return len;
+      },
+      *range);
 }
 
 esp_err_t _storage_restore(httpd_req_t* req, const std::string& type) {
@@ -220,6 +233,8 @@ esp_err_t _storage_restore(httpd_req_t* req, const std::string& type) {
     }
     ESP_RETURN_ON_ERROR(accessor->write_sector(idx, ota_data.data()));
   }
+  // Served files have been replaced.
+  fileserv_invalidate_index();
 
   ESP_RETURN_ON_ERROR(httpd_resp_set_status(req, HTTPD_204));
   ESP_RETURN_ON_ERROR(httpd_resp_send(req, NULL, 0));
@@ -250,6 +265,40 @@ esp_err_t _storage_reset(httpd_req_t* req, const std::string& type) {
   return ESP_OK;
 }
 
+#ifdef ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+
+inline constexpr char FEATURE_ASSET_CACHE[] = "/asset_cache";
+inline constexpr char ASSET_CACHE_STATS_TMPL[] =
+    R"json({"hits":%d,"misses":%d,"evictions":%d,"entries":%d,"bytes":%d,"free_heap":%d})json";
+
+bool sysfunc_asset_cache(const char* feature, httpd_req_t* req) {
+  if (strncmp(feature, FEATURE_ASSET_CACHE, utils::STRLEN(FEATURE_ASSET_CACHE)) != 0) return false;
+
+  if (feature[utils::STRLEN(FEATURE_ASSET_CACHE)] != '\0') {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed request");
+    return true;
+  }
+
+  switch (req->method) {
+    case HTTP_GET: {
+      AssetCacheStats stats = fileserv_cache_stats();
+      utils::DataBuf stats_buf(128);
+      httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+      httpd_resp_send(req,
+                      stats_buf.PrintTo(ASSET_CACHE_STATS_TMPL, stats.hits, stats.misses,
+                                        stats.evictions, stats.entries, stats.bytes,
+                                        esp_get_free_heap_size()),
+                      HTTPD_RESP_USE_STRLEN);
+    } break;
+
+    default:
+      return false;
+  }
+  return true;
+}
+
+#endif  // ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+
 bool storage_op_in_progress_ = false;
 
 bool sysfunc_storage(const char* feature, httpd_req_t* req) {
@@ -317,6 +366,9 @@ const std::vector<SysFuncHandler> subfunc_ = {
 #ifdef ZW_APPLIANCE_COMPONENT_WEB_OTA
     sysfunc_ota,
 #endif
+#ifdef ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+    sysfunc_asset_cache,
+#endif
 };
 
 esp_err_t _handler_sysfunc(httpd_req_t* req) {
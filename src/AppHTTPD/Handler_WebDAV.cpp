@@ -21,7 +21,9 @@
 #include "ZWUtils.hpp"
 #include "ZWAppConfig.h"
 
+#include "Interface.hpp"
 #include "Interface_Private.hpp"
+#include "Handler_FileServ.hpp"
 
 #ifdef ZW_APPLIANCE_COMPONENT_WEBDAV
 
@@ -56,12 +58,14 @@ inline constexpr char DAV_CACHE_CONTROL_VALUE[] = "no-cache";
 
 inline constexpr char DAV_HEADER_DAV[] = "DAV";
 inline constexpr char DAV_HEADER_ACCEPT_RANGES[] = "Accept-Ranges";
-inline constexpr char DAV_HEADER_CONTENT_LENGTH[] = "Content-Length";
 inline constexpr char DAV_HEADER_LAST_MODIFIED[] = "Last-Modified";
 inline constexpr char DAV_HEADER_LOCATION[] = "Location";
 inline constexpr char DAV_HEADER_ALLOW[] = "Allow";
 inline constexpr char DAV_HEADER_ETAG[] = "ETag";
 
+inline constexpr char DAV_ACCEPT_RANGES_VALUE[] = "bytes";
+inline constexpr char DAV_ETAG_TMPL[] = "%06lX:%08lX";
+
 #define DAV_DEPTH_INFINITE -1
 
 inline constexpr char DAV_STATUS_201_CREATED[] = "201 Created";
@@ -96,7 +100,7 @@ esp_err_t _COMMON_FS_HEADERS(const struct stat& st, httpd_req_t* req, utils::Dat
   }));
   ESP_RETURN_ON_ERROR(vcache.AllocAndPrep(20, [&](utils::DataBuf& buf) {
     return httpd_resp_set_hdr(req, DAV_HEADER_ETAG,
-                              buf.PrintTo("%06lX:%08lX", st.st_size & 0xffffff, st.st_mtime));
+                              buf.PrintTo(DAV_ETAG_TMPL, st.st_size & 0xffffff, st.st_mtime));
   }));
   return ESP_OK;
 }
@@ -410,25 +414,23 @@ inline esp_err_t _DAV_SEND_FILE(const FS::path& src, httpd_req_t* req, bool cont
 
   utils::DataBufStash vcache;
   ESP_RETURN_ON_ERROR(_COMMON_FS_HEADERS(st, req, vcache));
-  ESP_RETURN_ON_ERROR(vcache.AllocAndPrep(10, [&](utils::DataBuf& buf) {
-    return httpd_resp_set_hdr(req, DAV_HEADER_CONTENT_LENGTH, buf.PrintTo("%ld", st.st_size));
-  }));
+  ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req, DAV_HEADER_ACCEPT_RANGES, DAV_ACCEPT_RANGES_VALUE));
 
   if (!content) {
-    return httpd_resp_send(req, NULL, 0);
+    // Headers only, with the `Content-Length` of the file.
+    return httpd_resp_send(req, NULL, st.st_size);
   }
 
+  utils::DataBuf etag_buf(20);
+  auto range =
+      resolve_range(req, st.st_size, etag_buf.PrintTo(DAV_ETAG_TMPL, st.st_size & 0xffffff,
+                                                       st.st_mtime));
+  if (!range) return send_range_not_satisfiable(req, st.st_size);
+
   ESP_RETURN_ON_ERROR(httpd_resp_set_type(req, HTTP_MIME_BINARY));
   ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req, DAV_HEADER_CACHE_CONTROL, DAV_CACHE_CONTROL_VALUE));
-  ESP_LOGD(TAG, "Sending %ld bytes...", st.st_size);
-  size_t size = st.st_size;
-  char buf[1024];
-  while (size_t read_len = fread(buf, 1, sizeof(buf), *file)) {
-    ZW_BREAK_ON_ERROR_SIMPLE(httpd_resp_send_chunk(req, buf, read_len));
-    size -= read_len;
-  }
-  if (size) ESP_LOGW(TAG, "File read short by %d bytes", size);
-  return httpd_resp_send_chunk(req, NULL, 0);
+  ESP_LOGD(TAG, "Sending %d of %ld bytes...", range->length, st.st_size);
+  return send_file(req, *file, st.st_size, *range);
 }
 
 inline constexpr char _DAV_HTML_RESP_HEADER_STYLE[] =
@@ -609,7 +611,7 @@ inline const char* _DAV_ITEM_PROP(utils::DataBuf& buf, const char* src, const st
   strftime(time_buf, 32, HTTP_DATE_TMPL, gmtime_r(&st.st_mtime, &lt));
 
   utils::DataBuf etag_buf(16);
-  etag_buf.PrintTo("%06lX:%08lX", st.st_size & 0xffffff, st.st_mtime);
+  etag_buf.PrintTo(DAV_ETAG_TMPL, st.st_size & 0xffffff, st.st_mtime);
 
   if (S_ISREG(st.st_mode)) {
     return buf.PrintTo(_DAV_XML_RESP_FILE_PROP_TMPL, (char*)href_buf.data(), HTTP_MIME_BINARY,
@@ -765,7 +767,7 @@ esp_err_t DAVHandler::_MKCOL(void) {
 
 esp_err_t DAVHandler::_OPTIONS(void) {
   ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req_, DAV_HEADER_DAV, "1"));
-  ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req_, DAV_HEADER_ACCEPT_RANGES, "none"));
+  ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req_, DAV_HEADER_ACCEPT_RANGES, DAV_ACCEPT_RANGES_VALUE));
   std::string method_list;
   method_list.reserve(64);
   for (auto m : {HTTP_COPY, HTTP_DELETE, HTTP_GET, HTTP_HEAD, HTTP_MKCOL, HTTP_MOVE, HTTP_OPTIONS,
@@ -824,6 +826,17 @@ esp_err_t DAVHandler::_PUT(void) {
 esp_err_t _handler_webdav(httpd_req_t* req) {
   auto handler = DAVHandler::Create(req);
   if (handler) handler->Run();
+  switch (req->method) {
+    case HTTP_COPY:
+    case HTTP_MOVE:
+    case HTTP_DELETE:
+    case HTTP_PUT:
+      // Served files may have changed.
+      fileserv_invalidate_index();
+      break;
+    default:
+      break;
+  }
   ESP_LOGD(TAG, "+> Heap: %d; Stack: %d", esp_get_free_heap_size(),
            uxTaskGetStackHighWaterMark(NULL));
   return ESP_OK;
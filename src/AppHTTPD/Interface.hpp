@@ -2,6 +2,8 @@
 #ifndef APPHTTPD_INTERFACE
 #define APPHTTPD_INTERFACE
 
+#include <functional>
+
 #include "cJSON.h"
 
 #include "esp_http_server.h"
@@ -25,8 +27,36 @@ extern void add_ext_handler_registrar(HandlerRegistrar registrar);
 extern utils::DataOrError<std::string> query_parse_param(const char* query_frag, const char* name,
   size_t expect_len = 0);
 
+// Produces the next block of a response body into `buf`, up to `len` bytes.
+// Returns the number of bytes produced, 0 on failure.
+// Note that `buf` always has room for a whole flash sector, regardless of `len`.
+using BodyReader = std::function<size_t(char* buf, size_t len)>;
+
+// The part of a response body to send.
+struct BodyRange {
+  size_t start;
+  size_t length;
+  bool partial;  // False for the whole body, sent with a regular status
+};
+
+// Resolve the byte range requested by the `Range` header, for a body of `size` bytes.
+// Only a single range is supported; the whole body is resolved if no valid range is requested,
+// or the `If-Range` validator does not match `etag` (which may be NULL if there is none).
+// Returns `ESP_ERR_INVALID_SIZE` if the requested range is unsatisfiable.
+extern utils::DataOrError<BodyRange> resolve_range(httpd_req_t* req, size_t size,
+                                                   const char* etag);
+
+// Respond to a request with an unsatisfiable range, for a body of `size` bytes.
+extern esp_err_t send_range_not_satisfiable(httpd_req_t* req, size_t size);
+
+// Send a response body of known size in an HTTP handler
+// The headers are sent with the `Content-Length`, followed by the body without chunk framing.
+// For a partial `range`, the `reader` is expected to start from the range start.
+extern esp_err_t send_body(httpd_req_t* req, size_t size, const BodyReader& reader,
+                           const BodyRange& range = {});
+
 // Send file data as respose in an HTTP handler
-extern esp_err_t send_file(httpd_req_t* req, FILE* f, size_t size);
+extern esp_err_t send_file(httpd_req_t* req, FILE* f, size_t size, const BodyRange& range = {});
 
 // Send serialized JSON data as respose in an HTTP handler
 extern esp_err_t send_json(httpd_req_t* req, const cJSON* json);
@@ -1,14 +1,21 @@
+#include <algorithm>
 #include <string>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "cJSON.h"
 
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_spi_flash.h"
 #include "esp_http_server.h"
 
 #include "ZWUtils.hpp"
 #include "ZWAppConfig.h"
 
+#include "Interface.hpp"
+
 namespace zw::esp8266::app::httpd {
 
 inline constexpr char TAG[] = "HTTPD-UTILS";
@@ -40,20 +47,135 @@ utils::DataOrError<std::string> query_parse_param(const char* query_frag, const
   return result;
 }
 
-inline constexpr char HTTP_HEADER_CONTENT_LENGTH[] = "Content-Length";
+inline constexpr char HTTP_HEADER_RANGE[] = "Range";
+inline constexpr char HTTP_HEADER_IF_RANGE[] = "If-Range";
+inline constexpr char HTTP_HEADER_CONTENT_RANGE[] = "Content-Range";
+
+inline constexpr char HTTP_STATUS_206_PARTIAL_CONTENT[] = "206 Partial Content";
+inline constexpr char HTTP_STATUS_416_RANGE_NOT_SATISFIABLE[] = "416 Range Not Satisfiable";
+
+inline constexpr char HTTP_RANGE_BYTES_PREFIX[] = "bytes=";
+#define HTTP_RANGE_DELIM '-'
+#define HTTP_RANGE_LIST_DELIM ','
+inline constexpr char HTTP_ETAG_WEAK_PREFIX[] = "W/";
+
+std::string _get_header(httpd_req_t* req, const char* name) {
+  std::string value(httpd_req_get_hdr_value_len(req, name), '\0');
+  if (!value.empty() &&
+      httpd_req_get_hdr_value_str(req, name, &value.front(), value.length() + 1) != ESP_OK) {
+    value.clear();
+  }
+  return value;
+}
+
+// Parse a decimal position spanning [str, end); returns false if malformed.
+bool _parse_position(const char* str, const char* end, size_t& pos) {
+  if (str == end || !isdigit(*str)) return false;
+  char* parse_end;
+  pos = strtoul(str, &parse_end, 10);
+  return parse_end == end;
+}
+
+utils::DataOrError<BodyRange> resolve_range(httpd_req_t* req, size_t size, const char* etag) {
+  const BodyRange whole = {.start = 0, .length = size, .partial = false};
+  std::string range = _get_header(req, HTTP_HEADER_RANGE);
+  if (range.compare(0, utils::STRLEN(HTTP_RANGE_BYTES_PREFIX), HTTP_RANGE_BYTES_PREFIX) != 0) {
+    return whole;
+  }
+  std::string if_range = _get_header(req, HTTP_HEADER_IF_RANGE);
+  if (!if_range.empty()) {
+    // Only a strong ETag validates a range.
+    if (etag == nullptr || if_range != etag ||
+        strncmp(etag, HTTP_ETAG_WEAK_PREFIX, utils::STRLEN(HTTP_ETAG_WEAK_PREFIX)) == 0) {
+      return whole;
+    }
+  }
 
-esp_err_t send_file(httpd_req_t* req, FILE* f, size_t size) {
-  char size_buf[10];
-  snprintf(size_buf, 10, "%d", size);
-  ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req, HTTP_HEADER_CONTENT_LENGTH, size_buf));
+  const char* spec = range.c_str() + utils::STRLEN(HTTP_RANGE_BYTES_PREFIX);
+  const char* spec_end = range.c_str() + range.length();
+  const char* delim = strchr(spec, HTTP_RANGE_DELIM);
+  // Multiple ranges are not supported, just send the whole body instead.
+  if (delim == nullptr || strchr(spec, HTTP_RANGE_LIST_DELIM) != nullptr) return whole;
+
+  size_t first, last = size - 1;
+  if (delim == spec) {
+    // Suffix range, i.e. the last N bytes
+    size_t suffix;
+    if (!_parse_position(delim + 1, spec_end, suffix)) return whole;
+    if (suffix == 0 || size == 0) return ESP_ERR_INVALID_SIZE;
+    first = size - std::min(suffix, size);
+  } else {
+    if (!_parse_position(spec, delim, first)) return whole;
+    if (first >= size) return ESP_ERR_INVALID_SIZE;
+    if (delim + 1 != spec_end) {
+      if (!_parse_position(delim + 1, spec_end, last) || last < first) return whole;
+      last = std::min(last, size - 1);
+    }
+  }
+  ESP_LOGD(TAG, "Range [%d, %d] of %d bytes", first, last, size);
+  return BodyRange{.start = first, .length = last - first + 1, .partial = true};
+}
 
-  char buf[1024];
-  while (size_t read_len = fread(buf, 1, sizeof(buf), f)) {
-    ESP_RETURN_ON_ERROR(httpd_resp_send_chunk(req, buf, read_len));
+esp_err_t send_range_not_satisfiable(httpd_req_t* req, size_t size) {
+  utils::DataBuf content_range(24);
+  ESP_RETURN_ON_ERROR(httpd_resp_set_status(req, HTTP_STATUS_416_RANGE_NOT_SATISFIABLE));
+  ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(req, HTTP_HEADER_CONTENT_RANGE,
+                                         content_range.PrintTo("bytes */%d", size)));
+  return httpd_resp_send(req, NULL, 0);
+}
+
+// Body data is read and sent in blocks of a flash sector, which is also the file system block.
+#define SEND_BODY_BLOCK_SIZE SPI_FLASH_SEC_SIZE
+
+esp_err_t _send_all(httpd_req_t* req, const char* data, size_t len) {
+  while (len) {
+    int sent_len = httpd_send(req, data, len);
+    if (sent_len <= 0) {
+      ESP_LOGW(TAG, "Socket send failed (%d)", sent_len);
+      return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    data += sent_len;
+    len -= sent_len;
+  }
+  return ESP_OK;
+}
+
+esp_err_t send_body(httpd_req_t* req, size_t size, const BodyReader& reader,
+                    const BodyRange& range) {
+  utils::DataBuf content_range(40);
+  if (range.partial) {
+    ESP_RETURN_ON_ERROR(httpd_resp_set_status(req, HTTP_STATUS_206_PARTIAL_CONTENT));
+    ESP_RETURN_ON_ERROR(httpd_resp_set_hdr(
+        req, HTTP_HEADER_CONTENT_RANGE,
+        content_range.PrintTo("bytes %d-%d/%d", range.start, range.start + range.length - 1,
+                              size)));
+    size = range.length;
+  }
+  // Without content, `httpd_resp_send()` sends just the headers, with the given length.
+  ESP_RETURN_ON_ERROR(httpd_resp_send(req, NULL, size));
+
+  utils::DataBuf buf(SEND_BODY_BLOCK_SIZE);
+  while (size) {
+    size_t read_len = reader((char*)&buf.front(), std::min<size_t>(size, SEND_BODY_BLOCK_SIZE));
+    if (read_len == 0) {
+      // The promised length can no longer be met, fail the request to drop the connection.
+      ESP_LOGW(TAG, "Body read short by %d bytes", size);
+      return ESP_FAIL;
+    }
+    ESP_RETURN_ON_ERROR(_send_all(req, (const char*)buf.data(), read_len));
     size -= read_len;
   }
-  if (size) ESP_LOGW(TAG, "File read short by %d bytes", size);
-  return httpd_resp_send_chunk(req, NULL, 0);
+  return ESP_OK;
+}
+
+esp_err_t send_file(httpd_req_t* req, FILE* f, size_t size, const BodyRange& range) {
+  if (range.partial && fseek(f, range.start, SEEK_SET) != 0) {
+    ESP_LOGW(TAG, "Unable to seek to %d", range.start);
+    return ESP_FAIL;
+  }
+  // Reads of a whole block go straight into our buffer, bypassing the stdio buffer.
+  return send_body(
+      req, size, [f](char* buf, size_t len) { return fread(buf, 1, len, f); }, range);
 }
 
 esp_err_t send_json(httpd_req_t* req, const cJSON* json) {
@@ -1,5 +1,7 @@
 #include "Config.hpp"
 
+#include <string.h>
+
 #include "esp_log.h"
 
 #include "cJSON.h"
@@ -10,6 +12,9 @@
 
 #include "AppConfig/Interface.hpp"
 #include "Interface.hpp"
+#include "FixedPoint.hpp"
+#include "Interface_Private.hpp"
+#include "KeyframeShow.hpp"
 
 namespace zw::esp8266::app::twilight {
 namespace {
@@ -40,6 +45,7 @@ static const std::unordered_map<std::string_view, Config::Transition::Type>
         {"uniform-color", Config::Transition::Type::UNIFORM_COLOR},
         {"color-wipe", Config::Transition::Type::COLOR_WIPE},
         {"color-wheel", Config::Transition::Type::COLOR_WHEEL},
+        {"keyframe-show", Config::Transition::Type::KEYFRAME_SHOW},
 };
 
 utils::DataOrError<Config::Transition::Type> _decode_transition_type(const char* str) {
@@ -51,12 +57,39 @@ static const std::unordered_map<Config::Transition::Type, std::string_view>
         {Config::Transition::Type::UNIFORM_COLOR, "uniform-color"},
         {Config::Transition::Type::COLOR_WIPE, "color-wipe"},
         {Config::Transition::Type::COLOR_WHEEL, "color-wheel"},
+        {Config::Transition::Type::KEYFRAME_SHOW, "keyframe-show"},
 };
 
 std::string _encode_transition_type(const Config::Transition::Type& type) {
   return config::encode_enum<Config::Transition::Type, transition_type_to_name_>(type);
 }
 
+//----------------------
+// Color wipe direction
+
+static const std::unordered_map<std::string_view, Config::Transition::ColorWipe::Direction>
+    wipe_direction_name_to_type_ = {
+        {"LtR", Config::Transition::ColorWipe::Direction::LeftToRight},
+        {"RtL", Config::Transition::ColorWipe::Direction::RightToLeft},
+};
+
+utils::DataOrError<Config::Transition::ColorWipe::Direction> _decode_wipe_direction(
+    const char* str) {
+  return config::decode_enum<Config::Transition::ColorWipe::Direction,
+                             wipe_direction_name_to_type_>(str);
+}
+
+static const std::unordered_map<Config::Transition::ColorWipe::Direction, std::string_view>
+    wipe_direction_type_to_name_ = {
+        {Config::Transition::ColorWipe::Direction::LeftToRight, "LtR"},
+        {Config::Transition::ColorWipe::Direction::RightToLeft, "RtL"},
+};
+
+std::string _encode_wipe_direction(const Config::Transition::ColorWipe::Direction& direction) {
+  return config::encode_enum<Config::Transition::ColorWipe::Direction,
+                             wipe_direction_type_to_name_>(direction);
+}
+
 //----------------------
 // Event Type
 
@@ -289,12 +322,113 @@ esp_err_t _marshal_transition_uniform_color(utils::AutoReleaseRes<cJSON*>& conta
   return ESP_OK;
 }
 
+esp_err_t _parse_transition_color_wipe(const cJSON* json, Config::Transition::ColorWipe& container,
+                                       bool strict) {
+  PARSE_AND_ASSIGN_FIELD(json, container, color,
+                         (config::string_decoder<LS::RGB888, _decode_RGB8BHex>), strict);
+  PARSE_AND_ASSIGN_FIELD(json, container, blade_width,
+                         (config::string_decoder<uint16_t, decode_permille>), strict);
+  PARSE_AND_ASSIGN_FIELD(
+      json, container, direction,
+      (config::string_decoder<Config::Transition::ColorWipe::Direction, _decode_wipe_direction>),
+      strict);
+  return ESP_OK;
+}
+
+esp_err_t _marshal_transition_color_wipe(utils::AutoReleaseRes<cJSON*>& container,
+                                         const Config::Transition::ColorWipe& base,
+                                         const Config::Transition::ColorWipe& update) {
+  DIFF_AND_MARSHAL_FIELD(container, base, update, color,
+                         (config::string_encoder<LS::RGB888, _encode_RGB8BHex>));
+  DIFF_AND_MARSHAL_FIELD(container, base, update, blade_width,
+                         (config::string_encoder<uint16_t, encode_permille>));
+  DIFF_AND_MARSHAL_FIELD(
+      container, base, update, direction,
+      (config::string_encoder<Config::Transition::ColorWipe::Direction, _encode_wipe_direction>));
+  return ESP_OK;
+}
+
+esp_err_t _parse_transition_color_wheel(const cJSON* json,
+                                        Config::Transition::ColorWheel& container, bool strict) {
+  PARSE_AND_ASSIGN_FIELD(json, container, start_hue,
+                         (config::string_decoder<uint16_t, config::decode_short_size>), strict);
+  PARSE_AND_ASSIGN_FIELD(json, container, wheel_width,
+                         (config::string_decoder<uint16_t, decode_permille>), strict);
+  PARSE_AND_ASSIGN_FIELD(json, container, intensity,
+                         (config::string_decoder<uint16_t, config::decode_short_size>), strict);
+  return ESP_OK;
+}
+
+esp_err_t _marshal_transition_color_wheel(utils::AutoReleaseRes<cJSON*>& container,
+                                          const Config::Transition::ColorWheel& base,
+                                          const Config::Transition::ColorWheel& update) {
+  DIFF_AND_MARSHAL_FIELD(container, base, update, start_hue,
+                         (config::string_encoder<uint16_t, config::encode_short_size>));
+  DIFF_AND_MARSHAL_FIELD(container, base, update, wheel_width,
+                         (config::string_encoder<uint16_t, encode_permille>));
+  DIFF_AND_MARSHAL_FIELD(container, base, update, intensity,
+                         (config::string_encoder<uint16_t, config::encode_short_size>));
+  return ESP_OK;
+}
+
+using ShowFileName = decltype(Config::Transition::KeyframeShow::file);
+
+esp_err_t _parse_show_file(const cJSON* json, ShowFileName& file, bool strict) {
+  if (json == NULL) {
+    // A show transition is of no use without its file.
+    if (file[0] == '\0') {
+      ESP_LOGD(TAG, "Missing show file name");
+      return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+  }
+  const char* str = cJSON_GetStringValue(json);
+  // Show files are plain names within the show directory.
+  if (str == NULL || *str == '\0' || strlen(str) >= sizeof(file) || strchr(str, '/') != NULL) {
+    ESP_LOGD(TAG, "Invalid show file name");
+    return strict ? ESP_ERR_INVALID_ARG : ESP_OK;
+  }
+  // Stored configs may still reference a show that is yet to be uploaded.
+  if (strict && GetKeyframeShowSize(str) == 0) {
+    ESP_LOGD(TAG, "Show file '%s' missing or empty", str);
+    return ESP_ERR_INVALID_ARG;
+  }
+  strcpy(file, str);
+  return ESP_OK;
+}
+
+utils::DataOrError<cJSON*> _marshal_show_file(const ShowFileName& base,
+                                              const ShowFileName& update) {
+  if (strcmp(base, update) == 0) return (cJSON*)NULL;
+  if (cJSON* result = cJSON_CreateString(update)) return result;
+  return ESP_ERR_NO_MEM;
+}
+
+esp_err_t _parse_transition_keyframe_show(const cJSON* json,
+                                          Config::Transition::KeyframeShow& container,
+                                          bool strict) {
+  PARSE_FIELD_INPLACE(json, container, file, _parse_show_file, strict);
+  return ESP_OK;
+}
+
+esp_err_t _marshal_transition_keyframe_show(utils::AutoReleaseRes<cJSON*>& container,
+                                            const Config::Transition::KeyframeShow& base,
+                                            const Config::Transition::KeyframeShow& update) {
+  DIFF_AND_MARSHAL_FIELD(container, base, update, file, _marshal_show_file);
+  return ESP_OK;
+}
+
 esp_err_t _parse_transition(const cJSON* json, Config::Transition& container, bool strict) {
   PARSE_AND_ASSIGN_FIELD(json, container, duration_ms,
                          (config::string_decoder<size_t, config::decode_size>), strict);
+  const Config::Transition::Type prev_type = container.type;
   PARSE_AND_ASSIGN_FIELD(
       json, container, type,
       (config::string_decoder<Config::Transition::Type, _decode_transition_type>), strict);
+  // The parameters of the previous type do not carry over to the new one.
+  if (container.type != prev_type) {
+    container = {.type = container.type, .duration_ms = container.duration_ms};
+  }
 
   switch (container.type) {
     case Config::Transition::Type::UNIFORM_COLOR: {
@@ -302,11 +436,16 @@ esp_err_t _parse_transition(const cJSON* json, Config::Transition& container, bo
     } break;
 
     case Config::Transition::Type::COLOR_WIPE: {
-      ESP_RETURN_ON_ERROR(ESP_ERR_NOT_SUPPORTED);
+      ESP_RETURN_ON_ERROR(_parse_transition_color_wipe(json, container.color_wipe, strict));
     } break;
 
     case Config::Transition::Type::COLOR_WHEEL: {
-      ESP_RETURN_ON_ERROR(ESP_ERR_NOT_SUPPORTED);
+      ESP_RETURN_ON_ERROR(_parse_transition_color_wheel(json, container.color_wheel, strict));
+    } break;
+
+    case Config::Transition::Type::KEYFRAME_SHOW: {
+      ESP_RETURN_ON_ERROR(
+          _parse_transition_keyframe_show(json, container.keyframe_show, strict));
     } break;
 
     default:
@@ -330,16 +469,25 @@ std::string _print_transition(const Config::Transition& transition) {
       break;
     }
     case Config::Transition::Type::COLOR_WIPE: {
+      const auto& params = transition.color_wipe;
+      result.append(PrintBuf.PrintTo(", %s", LS::to_string(params.color).c_str()));
       result.append(
-          PrintBuf.PrintTo(", %s", LS::to_string(transition.uniform_color.color).c_str()));
-      result.append(", <-->");
-      result.append(", 100%W");
+          (params.direction == Config::Transition::ColorWipe::Direction::RightToLeft) ? ", <--"
+                                                                                      : ", -->");
+      result.append(PrintBuf.PrintTo(", %d.%d%%W", params.blade_width / 10,
+                                     params.blade_width % 10));
       break;
     }
     case Config::Transition::Type::COLOR_WHEEL: {
-      result.append(", 100deg");
-      result.append(", 100%W");
-      result.append(", 100%I");
+      const auto& params = transition.color_wheel;
+      result.append(PrintBuf.PrintTo(", %ddeg", params.start_hue));
+      result.append(PrintBuf.PrintTo(", %d.%d%%W", params.wheel_width / 10,
+                                     params.wheel_width % 10));
+      result.append(PrintBuf.PrintTo(", %d%%I", params.intensity));
+      break;
+    }
+    case Config::Transition::Type::KEYFRAME_SHOW: {
+      result.append(", '").append(transition.keyframe_show.file).append("'");
       break;
     }
     default:
@@ -363,11 +511,18 @@ esp_err_t _marshal_transition(utils::AutoReleaseRes<cJSON*>& container,
     } break;
 
     case Config::Transition::Type::COLOR_WIPE: {
-      ESP_RETURN_ON_ERROR(ESP_ERR_NOT_SUPPORTED);
+      ESP_RETURN_ON_ERROR(
+          _marshal_transition_color_wipe(container, base.color_wipe, update.color_wipe));
     } break;
 
     case Config::Transition::Type::COLOR_WHEEL: {
-      ESP_RETURN_ON_ERROR(ESP_ERR_NOT_SUPPORTED);
+      ESP_RETURN_ON_ERROR(
+          _marshal_transition_color_wheel(container, base.color_wheel, update.color_wheel));
+    } break;
+
+    case Config::Transition::Type::KEYFRAME_SHOW: {
+      ESP_RETURN_ON_ERROR(_marshal_transition_keyframe_show(container, base.keyframe_show,
+                                                            update.keyframe_show));
     } break;
 
     default:
@@ -623,6 +778,12 @@ esp_err_t _parse_events_list(const cJSON* json, Config::EventsList& events, bool
       continue;
     }
 
+    if (event_idx >= MAX_EVENTS) {
+      ESP_LOGW(TAG, "Too many events, only the first %d are kept", MAX_EVENTS);
+      if (strict) return ESP_ERR_INVALID_SIZE;
+      break;
+    }
+
     Config::Event* event;
     if (event_idx < events.size()) {
       event = &events[event_idx];
@@ -705,10 +866,13 @@ std::string print_transition(const Config::Transition& transition) {
 }
 
 std::string print_time(uint16_t time) { return _print_time(time); }
+std::string print_transition_type(Config::Transition::Type type) {
+  return _encode_transition_type(type);
+}
 std::string print_event(const Config::Event& event) { return _print_event(event); }
 
 utils::DataOrError<Config::Transition> parse_transition(const cJSON* json, bool strict) {
-  Config::Transition transition;
+  Config::Transition transition = {};
   ESP_RETURN_ON_ERROR(_parse_transition(json, transition, strict));
   return transition;
 }
@@ -1,13 +1,13 @@
 #include "EventSequencer.hpp"
 
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 
-#include <vector>
-#include <deque>
-#include <map>
-#include <set>
+#include <algorithm>
+#include <string>
 
+#include "esp_err.h"
 #include "esp_log.h"
 
 #include "ZWUtils.hpp"
@@ -20,160 +20,285 @@ namespace {
 
 inline constexpr char TAG[] = "TWiLight-EvtSeq";
 
-void _process_time_range(int32_t start, int32_t window_end, int16_t event_idx,
-                         const Config::Event::TimeRange& range, int32_t prev_offset,
-                         std::vector<RawEventEntry>& raw_events) {
-  int32_t end_second = -1;
-  // If event already finished, it has no impact
-  if (range.has_end) {
-    end_second = (range.end + 1) * SECONDS_IN_A_MINUTE - 1;
-    if (end_second < start) return;
+inline constexpr int32_t DAYS_IN_A_WEEK = 7;
+// Annual events without end time may carry over from a year ago.
+inline constexpr int32_t ANNUAL_CARRY_OVER_DAYS = 366;
+
+int32_t _year_day_number(int year) {
+  // `year` is in `tm_year` convention, i.e. years since 1900.
+  const int32_t y = year + 1900 - 1;
+  return 365 * (y - 1969) + (y / 4 - y / 100 + y / 400) - (1969 / 4 - 1969 / 100 + 1969 / 400);
+}
+
+inline constexpr uint8_t DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+inline constexpr uint16_t DAYS_BEFORE_MONTH[] = {0,   31,  59,  90,  120, 151,
+                                                 181, 212, 243, 273, 304, 334};
+static_assert(DAYS_BEFORE_MONTH[11] + DAYS_IN_MONTH[11] == 365);
+
+constexpr bool _is_leap_year(int year) {
+  // `year` is in `tm_year` convention, i.e. years since 1900.
+  const int y = year + 1900;
+  return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+// Day of year of the given date, or -1 if the date does not exist in that year.
+int _day_of_year(int year, const Config::Event::DayOfYear& date) {
+  if (date.month_idx >= 12 || date.day < 1) return -1;
+
+  // Only months after February are shifted by the leap day.
+  const bool leap_year = _is_leap_year(year);
+  const int month_days = DAYS_IN_MONTH[date.month_idx] + (leap_year && date.month_idx == 1);
+  if (date.day > month_days) {
+    // E.g. the event is on the leap day (Feb 29), but the year is not a leap year.
+    return -1;
   }
+  return DAYS_BEFORE_MONTH[date.month_idx] + (leap_year && date.month_idx > 1) + date.day - 1;
+}
 
-  const int32_t start_second = range.start * SECONDS_IN_A_MINUTE;
-  if (start_second > start) {
-    // Not yet started for today?
-    if (start_second <= window_end) {
-      // Only care about the event if it starts within the precomputed range
-      raw_events.push_back({start_second, end_second, event_idx});
-    }
-    // End specified, must have finished from last cycle, therefore no impact
-    if (range.has_end) return;
-    // Started from last cycle without end time
-    raw_events.push_back({start_second - prev_offset, end_second, event_idx});
-  } else {
-    // Already started and not finished
-    raw_events.push_back({start_second, end_second, event_idx});
+void _add_time_range(int32_t day, const Config::Event::TimeRange& range, int16_t event_idx,
+                     std::vector<TimelineBoundary>& boundaries) {
+  const int32_t start_second = day * SECONDS_IN_A_DAY + range.start * SECONDS_IN_A_MINUTE;
+  boundaries.push_back({
+      .time = start_second,
+      .event_idx = event_idx,
+      .type = range.has_end ? TimelineBoundary::Type::START
+                            : TimelineBoundary::Type::START_OPEN_ENDED,
+  });
+  if (range.has_end) {
+    int32_t end_second = day * SECONDS_IN_A_DAY + (range.end + 1) * SECONDS_IN_A_MINUTE - 1;
+    // The time range wraps across mid-night
+    if (range.end < range.start) end_second += SECONDS_IN_A_DAY;
+    boundaries.push_back({
+        .time = end_second,
+        .event_idx = event_idx,
+        .type = TimelineBoundary::Type::END,
+    });
   }
 }
 
+#ifndef NDEBUG
+std::string _print_offset(int32_t offset) {
+  static constexpr const char* weekdays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+  return utils::DataBuf(12).PrintTo(
+      "%s %s", weekdays[offset / SECONDS_IN_A_DAY],
+      print_time((offset % SECONDS_IN_A_DAY) / SECONDS_IN_A_MINUTE).c_str());
+}
+#endif
+
 }  // namespace
 
-std::vector<RawEventEntry> generate_raw_events(const std::vector<Config::Event>& events,
-                                               const struct tm& start_tm) {
-  int32_t start = get_second_of_day(start_tm);
-  int32_t window_end = start + PRECOMPUTE_WINDOW;
+int32_t get_day_number(const struct tm& time) {
+  return _year_day_number(time.tm_year) + time.tm_yday;
+}
+
+esp_err_t EventTimeline::Compile(const Config::EventsList& events) {
+  weekly_.clear();
+  annual_.clear();
+  segments_.clear();
+  week_day_ = TIMELINE_NO_START;
 
-  std::vector<RawEventEntry> result;
-  for (int16_t event_idx = 0; event_idx < events.size(); event_idx++) {
-    const Config::Event& event = events[event_idx];
+  if (events.size() > MAX_EVENTS) {
+    ESP_LOGE(TAG, "Too many events (%d > %d)", events.size(), MAX_EVENTS);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  for (size_t idx = 0; idx < events.size(); idx++) {
+    const Config::Event& event = events[idx];
+    const int16_t event_idx = idx;
     switch (event.type) {
       case Config::Event::Type::RECURRENT_DAILY: {
-        _process_time_range(start, window_end, event_idx, event.daily, SECONDS_IN_A_DAY, result);
+        for (int32_t day = 0; day < DAYS_IN_A_WEEK; ++day) {
+          _add_time_range(day, event.daily, event_idx, weekly_);
+        }
       } break;
 
       case Config::Event::Type::RECURRENT_WEEKLY: {
-        uint8_t day_mask = 1 << start_tm.tm_wday;
-        bool on_day = event.weekly.days & day_mask;
-
-        int prev_days = 0;
-        while (++prev_days != 7) {
-          day_mask = (day_mask == 1) ? (1 << 6) : (day_mask >> 1);
-          if (event.weekly.days & day_mask) break;
+        for (int32_t day = 0; day < DAYS_IN_A_WEEK; ++day) {
+          if (event.weekly.days & (1 << day)) {
+            _add_time_range(day, event.weekly, event_idx, weekly_);
+          }
         }
-        _process_time_range(on_day ? start : -1, on_day ? window_end : -1, event_idx, event.weekly,
-                            prev_days * SECONDS_IN_A_DAY, result);
       } break;
 
       case Config::Event::Type::RECURRENT_ANNUAL: {
-        struct tm event_date_approx = start_tm;
-        event_date_approx.tm_hour = 12;  // Set to mid-day to avoid boundary wrapping
-        event_date_approx.tm_mday = event.annual.date.day;
-        event_date_approx.tm_mon = event.annual.date.month_idx;
-        event_date_approx.tm_year = start_tm.tm_year;
-
-        if (mktime(&event_date_approx) < 0) {
-          ESP_LOGW(TAG, "Failed to convert calendar time!");
-          continue;
-        }
-        if (event_date_approx.tm_mday != event.annual.date.day) {
-          // The event is on the leap day (Feb 29), but current year is not a leap year.
-          continue;
-        }
-        bool on_day = start_tm.tm_yday == event_date_approx.tm_yday;
-        int prev_days = start_tm.tm_yday - event_date_approx.tm_yday;
-        if (prev_days <= 0) prev_days += 365;
-        _process_time_range(on_day ? start : -1, on_day ? window_end : -1, event_idx, event.weekly,
-                            prev_days * SECONDS_IN_A_DAY, result);
+        annual_.push_back({event.annual, event_idx});
       } break;
 
       default:
         ESP_LOGW(TAG, "Unsupported event: %s", print_event(event).c_str());
     }
   }
-  return result;
+  // Time ranges wrapping across the end of the week end in its beginning.
+  for (TimelineBoundary& boundary : weekly_) {
+    if (boundary.time >= SECONDS_IN_A_WEEK) boundary.time -= SECONDS_IN_A_WEEK;
+  }
+  std::sort(weekly_.begin(), weekly_.end());
+
+  // Release the storage of any previous compilation, and reserve for the worst case of a
+  // folded week: an annual event may occur twice within the range of interest of a week.
+  weekly_.shrink_to_fit();
+  annual_.shrink_to_fit();
+  std::vector<TimelineBoundary>().swap(annual_boundaries_);
+  annual_boundaries_.reserve(2 * 2 * annual_.size());
+  std::vector<TimelineSegment>().swap(segments_);
+  segments_.reserve(weekly_.size() + annual_boundaries_.capacity() + 1);
+
+  ESP_LOGI(TAG, "Compiled %d weekly boundaries and %d annual events", weekly_.size(),
+           annual_.size());
+  return ESP_OK;
 }
 
-struct RawEventEntryCompare {
-  bool operator()(const RawEventEntry* a, const RawEventEntry* b) const {
-    return a->event_idx != b->event_idx && a->event_idx != EVENT_IDX_MANUAL_OVERRIDE &&
-           (a->event_idx < b->event_idx || b->event_idx == EVENT_IDX_MANUAL_OVERRIDE);
+void EventTimeline::_fold(int32_t week_day, int year) {
+  // Extending into the following week resumes the sweep from where it stopped,
+  // so only boundaries within the new week need to be processed.
+  const bool extend = week_day_ != TIMELINE_NO_START && week_day == week_day_ + DAYS_IN_A_WEEK;
+  if (extend) {
+    const TimelineSegment& last_segment = segments_.back();
+    int32_t last_start = carried_last_start_;
+    if (last_segment.last_start_idx != SEGMENT_IDX_NONE) {
+      last_start = segments_[last_segment.last_start_idx].start;
+    }
+    carried_last_start_ =
+        (last_start == TIMELINE_NO_START) ? TIMELINE_NO_START : last_start - SECONDS_IN_A_WEEK;
+  } else {
+    active_events_.Clear();
+    open_ended_events_.Clear();
+    carried_last_start_ = TIMELINE_NO_START;
   }
-};
+  const int32_t sweep_from = extend ? 0 : INT32_MIN;
+  // A time range may wrap across mid-night into the week.
+  const int32_t annual_from_day = extend ? -1 : -ANNUAL_CARRY_OVER_DAYS;
+  week_day_ = TIMELINE_NO_START;
 
-std::deque<EventEntry> convert_raw_events(std::vector<RawEventEntry>&& raw_events,
-                                          int32_t second_of_day) {
-  struct EventData {
-    std::vector<const RawEventEntry*> starts;
-    std::vector<const RawEventEntry*> ends;
-  };
-  std::map<int32_t, EventData> time_to_events;
-  for (const RawEventEntry& event : raw_events) {
-    time_to_events[event.start].starts.push_back(&event);
-    if (event.end >= 0) time_to_events[event.end].ends.push_back(&event);
+  // The week may straddle two years, and may be affected by occurrences from the last year.
+  annual_boundaries_.clear();
+  for (const AnnualEntry& entry : annual_) {
+    for (int event_year = year - 1; event_year <= year + 1; ++event_year) {
+      int day_of_year = _day_of_year(event_year, entry.annual.date);
+      if (day_of_year < 0) continue;
+
+      int32_t day = _year_day_number(event_year) + day_of_year - week_day;
+      if (day < annual_from_day || day >= DAYS_IN_A_WEEK) continue;
+      _add_time_range(day, entry.annual, entry.event_idx, annual_boundaries_);
+    }
   }
+  std::sort(annual_boundaries_.begin(), annual_boundaries_.end());
 
-  int16_t effective_event_idx = EVENT_IDX_UNCONFIGURED;
-  int32_t last_event_end = -1;
-  int32_t end_time = std::min(second_of_day + PRECOMPUTE_WINDOW, SECONDS_IN_A_DAY);
-  std::set<const RawEventEntry*, RawEventEntryCompare> active_events;
-
-  std::deque<EventEntry> result;
-  ESP_LOGI(TAG, "--- Event Sequence From %s ---",
-           print_time(second_of_day / SECONDS_IN_A_MINUTE).c_str());
-  for (auto& [time, event_data] : time_to_events) {
-    // Events without specific end-time ends when the next scheduled event starts
-    bool scheduled_event_start = false;
-    for (const RawEventEntry* event : event_data.starts) {
-      if (event->event_idx != EVENT_IDX_MANUAL_OVERRIDE) {
-        scheduled_event_start = true;
-        break;
+  // Merge the weekly boundaries, replayed over the previous and the current week, with
+  // the annual boundaries. Unless extending, replaying the previous week establishes
+  // the events carried into this week.
+  auto weekly_iter = weekly_.cbegin();
+  int32_t weekly_lap = extend ? 0 : -SECONDS_IN_A_WEEK;
+  auto annual_iter = annual_boundaries_.cbegin();
+  auto merge_boundary = [&](TimelineBoundary& boundary) {
+    if (weekly_iter == weekly_.end() && weekly_lap < 0) {
+      weekly_iter = weekly_.begin();
+      weekly_lap = 0;
+    }
+    const bool has_weekly = weekly_iter != weekly_.end();
+    const bool has_annual = annual_iter != annual_boundaries_.end();
+    if (has_weekly) {
+      boundary = *weekly_iter;
+      boundary.time += weekly_lap;
+      if (!has_annual || !(*annual_iter < boundary)) {
+        ++weekly_iter;
+        return true;
       }
     }
+    if (has_annual) {
+      boundary = *annual_iter++;
+      return true;
+    }
+    return false;
+  };
+  auto next_boundary = [&](TimelineBoundary& boundary) {
+    while (merge_boundary(boundary)) {
+      if (boundary.time >= sweep_from) return true;
+    }
+    return false;
+  };
+
+  // The highest active event index wins.
+  int16_t effective_event_idx = active_events_.Highest();
+  uint16_t last_start_idx = SEGMENT_IDX_NONE;
+
+  segments_.clear();
+  auto add_segment = [&](int32_t time, bool scheduled_event_start) {
+    // Merge into the previous segment if nothing observable has changed
+    if (!segments_.empty() && !scheduled_event_start &&
+        segments_.back().event_idx == effective_event_idx)
+      return;
+    if (scheduled_event_start) last_start_idx = segments_.size();
+    segments_.push_back({time, effective_event_idx, last_start_idx});
+  };
+
+  TimelineBoundary boundary;
+  bool has_boundary = next_boundary(boundary);
+  while (has_boundary && boundary.time < SECONDS_IN_A_WEEK) {
+    const int32_t time = boundary.time;
+    // Capture the events carried into the week
+    if (time > 0 && segments_.empty()) add_segment(0, false);
+
+    // Events without specific end-time ends when the next scheduled event starts.
+    // Note that starts are ordered before ends of the same time.
+    const bool scheduled_event_start = boundary.type != TimelineBoundary::Type::END;
     if (scheduled_event_start) {
-      for (auto it = active_events.begin(); it != active_events.end();) {
-        if ((*it)->end < 0) {
-          it = active_events.erase(it);
-          continue;
-        }
-        ++it;
-      }
+      active_events_.Reset(open_ended_events_);
+      open_ended_events_.Clear();
+      if (time < 0) carried_last_start_ = time;
     }
-    active_events.insert(event_data.starts.begin(), event_data.starts.end());
-    for (const RawEventEntry* event : event_data.ends) active_events.erase(event);
-
-    if (time >= second_of_day) {
-      if (time >= end_time) {
-        result.push_back({.completion = end_time, .event_idx = effective_event_idx});
-        ESP_LOGI(TAG, "%d. Event %d --> [%s]", result.size(), effective_event_idx,
-                 print_time(end_time / SECONDS_IN_A_MINUTE).c_str());
-        last_event_end = end_time;
-        break;
+    do {
+      switch (boundary.type) {
+        case TimelineBoundary::Type::START:
+          active_events_.Set(boundary.event_idx);
+          break;
+        case TimelineBoundary::Type::START_OPEN_ENDED:
+          active_events_.Set(boundary.event_idx);
+          open_ended_events_.Set(boundary.event_idx);
+          break;
+        case TimelineBoundary::Type::END:
+          active_events_.Reset(boundary.event_idx);
+          break;
       }
-      result.push_back({.completion = time, .event_idx = effective_event_idx});
-      ESP_LOGI(TAG, "%d. Event %d --> %s", result.size(), effective_event_idx,
-               print_time(time / SECONDS_IN_A_MINUTE).c_str());
-      last_event_end = time;
-    }
-    effective_event_idx =
-        active_events.empty() ? EVENT_IDX_UNCONFIGURED : (*active_events.rbegin())->event_idx;
+    } while ((has_boundary = next_boundary(boundary)) && boundary.time == time);
+
+    effective_event_idx = active_events_.Highest();
+    if (time >= 0) add_segment(time, scheduled_event_start);
+  }
+  if (segments_.empty()) add_segment(0, false);
+  week_day_ = week_day;
+
+  ESP_LOGI(TAG, "--- Event Timeline (%d segments, %s) ---", segments_.size(),
+           extend ? "extended" : "rebuilt");
+#ifndef NDEBUG
+  for (size_t idx = 0; idx < segments_.size(); ++idx) {
+    ESP_LOGD(TAG, "%d. %s --> Event %d", idx + 1, _print_offset(segments_[idx].start).c_str(),
+             segments_[idx].event_idx);
   }
-  if (last_event_end < end_time) {
-    result.push_back({.completion = end_time, .event_idx = effective_event_idx});
-    ESP_LOGI(TAG, "%d. Event %d --> {%s}", result.size(), effective_event_idx,
-             print_time(end_time / SECONDS_IN_A_MINUTE).c_str());
+#endif
+}
+
+utils::DataOrError<TimelineEntry> EventTimeline::Lookup(const struct tm& time_tm) {
+  const int32_t week_day = get_day_number(time_tm) - time_tm.tm_wday;
+  if (week_day != week_day_) _fold(week_day, time_tm.tm_year);
+
+  const int32_t offset = time_tm.tm_wday * SECONDS_IN_A_DAY + get_second_of_day(time_tm);
+  auto iter = std::upper_bound(
+      segments_.begin(), segments_.end(), offset,
+      [](int32_t offset, const TimelineSegment& segment) { return offset < segment.start; });
+  // The first segment always starts at the beginning of the week.
+  const TimelineSegment& segment = *(iter - 1);
+
+  const int64_t base = (int64_t)week_day * SECONDS_IN_A_DAY;
+  int32_t last_start = carried_last_start_;
+  if (segment.last_start_idx != SEGMENT_IDX_NONE) {
+    last_start = segments_[segment.last_start_idx].start;
   }
-  return result;
+  return TimelineEntry{
+      .completion = base + ((iter == segments_.end()) ? SECONDS_IN_A_WEEK : iter->start),
+      .last_start = (last_start == TIMELINE_NO_START) ? TIMELINE_NO_START : base + last_start,
+      .event_idx = segment.event_idx,
+  };
 }
 
-}  // namespace zw::esp8266::app::twilight
\ No newline at end of file
+}  // namespace zw::esp8266::app::twilight
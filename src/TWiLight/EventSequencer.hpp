@@ -6,36 +6,139 @@
 // If the module offers features for external used, it will put
 // them in the `Interface.h`.
 
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 
+#include <array>
 #include <vector>
-#include <deque>
+
+#include "esp_err.h"
+
+#include "ZWUtils.hpp"
 
 #include "Interface.hpp"
 #include "Interface_Private.hpp"
 
 namespace zw::esp8266::app::twilight {
 
+inline constexpr int32_t SECONDS_IN_A_WEEK = 7 * SECONDS_IN_A_DAY;
+
+// Marks a timeline position before any scheduled event start.
+inline constexpr int32_t TIMELINE_NO_START = INT32_MIN;
+
 inline int32_t get_second_of_day(const struct tm& time) {
   return time.tm_hour * SECONDS_IN_AN_HOUR + time.tm_min * SECONDS_IN_A_MINUTE + time.tm_sec;
 }
 
-struct RawEventEntry {
-  int32_t start, end;
+// Number of days since 1970-01-01 of the calendar date in `time`.
+// Only `tm_year` and `tm_yday` are used, no time zone rules involved.
+int32_t get_day_number(const struct tm& time);
+
+// A continuous local time scale, in seconds since 1970-01-01 00:00 local time.
+// It is 64-bit, so that it does not run out in 2038.
+inline int64_t get_local_seconds(const struct tm& time) {
+  return (int64_t)get_day_number(time) * SECONDS_IN_A_DAY + get_second_of_day(time);
+}
+
+struct TimelineBoundary {
+  enum class Type : uint8_t {
+    START,             // Start of an event with end time
+    START_OPEN_ENDED,  // Start of an event without end time
+    END,
+  };
+
+  int32_t time;  // Offset from the start of the week
   int16_t event_idx;
+  Type type;
+
+  bool operator<(const TimelineBoundary& other) const {
+    // Within the same time, all starts are processed before the ends.
+    return time < other.time || (time == other.time && type < other.type);
+  }
 };
 
-// Given a list of events, and timing information, produce a raw sequence of events
-// that may impact the state covering a predefined duration.
+inline constexpr uint16_t SEGMENT_IDX_NONE = UINT16_MAX;
+
+struct TimelineSegment {
+  int32_t start;            // Offset from the start of the week
+  int16_t event_idx;        // Effective event index, see `EventEntry`
+  uint16_t last_start_idx;  // The segment starting with the latest scheduled event start
+};
+
+// Result of a timeline lookup; all times are in local seconds.
+struct TimelineEntry {
+  int64_t completion;  // Completion time of the current segment
+  int64_t last_start;  // Latest scheduled event start, or `TIMELINE_NO_START`
+  int16_t event_idx;
+};
+
+// A set of events, bit-indexed by event index.
+class EventMask {
+ public:
+  void Clear(void) { words_ = {}; }
+  void Set(size_t event_idx) { words_[event_idx / WORD_BITS] |= _bit(event_idx); }
+  void Reset(size_t event_idx) { words_[event_idx / WORD_BITS] &= ~_bit(event_idx); }
+  void Reset(const EventMask& events) {
+    for (size_t i = 0; i < words_.size(); ++i) words_[i] &= ~events.words_[i];
+  }
+
+  // The highest event index in the set, or `EVENT_IDX_UNCONFIGURED` if empty.
+  int16_t Highest(void) const {
+    for (size_t i = words_.size(); i-- > 0;) {
+      if (words_[i]) return i * WORD_BITS + WORD_BITS - 1 - __builtin_clz(words_[i]);
+    }
+    return EVENT_IDX_UNCONFIGURED;
+  }
+
+ private:
+  static constexpr size_t WORD_BITS = 32;
+  static uint32_t _bit(size_t event_idx) { return uint32_t{1} << (event_idx % WORD_BITS); }
+
+  std::array<uint32_t, (MAX_EVENTS + WORD_BITS - 1) / WORD_BITS> words_ = {};
+};
+
+// A flat, sorted timeline of effective events over a week (starting Sunday 00:00).
+//
+// The daily and weekly events are compiled once into sorted boundaries relative to
+// the start of a week. Annual events are folded in, and the effective event segments
+// are swept, only when a lookup lands in a week different from the previous one.
+// All other lookups are a binary search.
 //
-// Parameters:
-//   events -- a list of configured events
-//   start_tm -- the start time of interest
-std::vector<RawEventEntry> generate_raw_events(const std::vector<Config::Event>& events,
-                                               const struct tm& start_tm);
+// When a lookup moves on to the following week, the sweep resumes from the state at
+// the end of the previous week, instead of replaying the events carried into it.
+//
+// The storage is sized from the compiled events, and reserved for the worst case of a
+// week when compiling, so that lookups never allocate from the heap.
+class EventTimeline {
+ public:
+  // Compile a list of configured events; drops any previously folded week.
+  esp_err_t Compile(const Config::EventsList& events);
+
+  // Find the effective event at the given local time.
+  utils::DataOrError<TimelineEntry> Lookup(const struct tm& time_tm);
+
+ private:
+  struct AnnualEntry {
+    Config::Event::Annual annual;
+    int16_t event_idx;
+  };
 
-std::deque<EventEntry> convert_raw_events(std::vector<RawEventEntry>&& raw_events,
-                                          int32_t second_of_day);
+  // Fold annual events into the week starting at `week_day`, and sweep the segments.
+  // If `week_day` follows the currently folded week, the sweep is extended into it.
+  void _fold(int32_t week_day, int year);
+
+  std::vector<TimelineBoundary> weekly_;
+  std::vector<AnnualEntry> annual_;
+  std::vector<TimelineBoundary> annual_boundaries_;
+
+  int32_t week_day_ = TIMELINE_NO_START;
+  int32_t carried_last_start_ = TIMELINE_NO_START;
+  // Sweep state at the end of the folded week: the active events, and those
+  // among them without specific end-time.
+  EventMask active_events_;
+  EventMask open_ended_events_;
+  std::vector<TimelineSegment> segments_;
+};
 
-}  // namespace zw::esp8266::app::twilight
\ No newline at end of file
+}  // namespace zw::esp8266::app::twilight
@@ -0,0 +1,43 @@
+// Fixed-point fractions for TWiLight
+
+// Note that this header intentionally doesn't have `#ifndef *_H`
+// or `pragma once`. This is because it is an internal unit to
+// the local module, never intended to be included anywhere else.
+// If the module offers features for external used, it will put
+// them in the `Interface.h`.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "esp_err.h"
+
+#include "ZWUtils.hpp"
+
+namespace zw::esp8266::app::twilight {
+
+// Decode a decimal number, e.g. "0.3", into units of 1/1000 (i.e. 300).
+// Digits beyond the third decimal place are dropped.
+inline utils::DataOrError<uint16_t> decode_permille(const char* str) {
+  uint32_t value = 0;
+  size_t digits = 0;
+  for (; *str >= '0' && *str <= '9'; ++str, ++digits) {
+    value = value * 10 + (*str - '0');
+    if (value > UINT16_MAX / 1000) return ESP_ERR_INVALID_ARG;
+  }
+  value *= 1000;
+  if (*str == '.') {
+    for (uint32_t scale = 100; *++str >= '0' && *str <= '9'; scale /= 10, ++digits) {
+      value += (*str - '0') * scale;
+    }
+  }
+  if (*str != '\0' || digits == 0 || value > UINT16_MAX) return ESP_ERR_INVALID_ARG;
+  return (uint16_t)value;
+}
+
+inline std::string encode_permille(const uint16_t& value) {
+  return utils::DataBuf(8).PrintTo("%d.%03d", value / 1000, value % 1000);
+}
+
+}  // namespace zw::esp8266::app::twilight
@@ -1,15 +1,23 @@
 #include "HTTPD_Handler.hpp"
 
+#include <string>
+#include <vector>
+#include <time.h>
+
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "cJSON.h"
 
 #include "ZWUtils.hpp"
 
 #include "AppHTTPD/Interface.hpp"
+#include "AppTime/Interface.hpp"
 
 #include "Interface_Private.hpp"
+#include "Config.hpp"
+#include "EventSequencer.hpp"
 
 namespace zw::esp8266::app::twilight {
 namespace {
@@ -302,7 +310,307 @@ bool _subfunc_override(const char* feature, httpd_req_t* req) {
   return true;
 }
 
-const std::vector<SubFuncHandler> subfunc_ = {_subfunc_setup, _subfunc_override};
+//----------------------
+// Simulate Subfunction
+
+inline constexpr char FEATURE_SIMULATE_PREFIX[] = "/simulate";
+
+inline constexpr char PARAM_SIMULATE_DAYS[] = "days";
+inline constexpr int32_t SIMULATE_DEFAULT_DAYS = 7;
+inline constexpr int32_t SIMULATE_MAX_DAYS = 366;
+
+inline constexpr char HTTP_MIME_TEXT[] = "text/plain";
+
+std::string _print_simulated_event(const struct tm& time_tm, int16_t event_idx,
+                                   const Config::EventsList& events,
+                                   const EventTransitions& resolved) {
+  std::string event_str =
+      utils::DataBuf(32).PrintTo("%04d-%02d-%02d %s | ", time_tm.tm_year + 1900,
+                                 time_tm.tm_mon + 1, time_tm.tm_mday,
+                                 print_time(time_tm.tm_hour * 60 + time_tm.tm_min).c_str());
+  if (event_idx < 0) {
+    event_str.append("No configured event\n");
+    event_str.append("  ").append(print_transition(TWILIGHT_NO_CONFIG_TRANSITION)).append("\n");
+    return event_str;
+  }
+  event_str.append(utils::DataBuf(16).PrintTo("Event %d\n", event_idx));
+  // The transitions as queued by the service, in place of any unknown ones.
+  const auto& names = events[event_idx].transitions;
+  for (size_t idx = 0; idx < names.size(); ++idx) {
+    const Config::Transition* transition = resolved.transitions[resolved.start[event_idx] + idx];
+    event_str.append("  '").append(names[idx]).append("'");
+    if (transition == &TWILIGHT_NO_CONFIG_TRANSITION) event_str.append(" (unknown)");
+    event_str.append(": ").append(print_transition(*transition)).append("\n");
+  }
+  return event_str;
+}
+
+// Fast-forward the event timeline from now over a number of days, and report
+// every change of the effective event, along with the transitions it would run.
+// In setup mode, the pending (unsaved) events are simulated.
+esp_err_t _simulate_schedule(int32_t days, httpd_req_t* req) {
+  auto config_state = GetConfigState();
+  if (!config_state) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                               "Error fetching config state");
+  }
+  auto time_tm = time::GetLocalTime();
+  if (!time_tm) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Unable to get local time");
+  }
+
+  // Outside of setup, the timeline already compiled for the service is reused.
+  EventTimeline timeline;
+  const Config::EventsList& events = config_state->config.events;
+  if (!config_state->setup) {
+    ESP_RETURN_ON_ERROR(CopyEventTimeline(timeline));
+  } else if (timeline.Compile(events) != ESP_OK) {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unable to compile events");
+  }
+  EventTransitions resolved;
+  ResolveEventTransitions(config_state->config, resolved);
+
+  ESP_RETURN_ON_ERROR(httpd_resp_set_type(req, HTTP_MIME_TEXT));
+  int64_t local_seconds = get_local_seconds(*time_tm);
+  const int64_t end_seconds = local_seconds + days * SECONDS_IN_A_DAY;
+  int16_t last_event_idx = EVENT_IDX_UNINITIALIZED;
+  uint32_t lookups = 0, changes = 0;
+  int64_t lookup_us = 0;
+  while (local_seconds < end_seconds) {
+    int64_t lookup_start = esp_timer_get_time();
+    auto entry = timeline.Lookup(*time_tm);
+    lookup_us += esp_timer_get_time() - lookup_start;
+    ++lookups;
+    if (!entry) {
+      ESP_RETURN_ON_ERROR(httpd_resp_send_chunk(req, "Timeline lookup failed!\n",
+                                                HTTPD_RESP_USE_STRLEN));
+      break;
+    }
+
+    if (entry->event_idx != last_event_idx) {
+      last_event_idx = entry->event_idx;
+      ++changes;
+      std::string event_str = _print_simulated_event(*time_tm, last_event_idx, events, resolved);
+      ESP_RETURN_ON_ERROR(httpd_resp_send_chunk(req, event_str.data(), event_str.length()));
+    }
+
+    // Local seconds map to the local calendar the same way epoch seconds map to UTC.
+    local_seconds = entry->completion;
+    time_t next_time = local_seconds;
+    gmtime_r(&next_time, &*time_tm);
+  }
+
+  utils::DataBuf summary_buf(96);
+  ESP_RETURN_ON_ERROR(httpd_resp_send_chunk(
+      req,
+      summary_buf.PrintTo("--- %d days, %u event changes, %u lookups in %u us ---\n", days,
+                          changes, lookups, (uint32_t)lookup_us),
+      HTTPD_RESP_USE_STRLEN));
+  return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+bool _subfunc_simulate(const char* feature, httpd_req_t* req) {
+  if (strncmp(feature, FEATURE_SIMULATE_PREFIX, utils::STRLEN(FEATURE_SIMULATE_PREFIX)) != 0)
+    return false;
+
+  if (req->method != HTTP_GET) {
+    httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Unexpected method");
+    return true;
+  }
+
+  const char* query_frag = feature + utils::STRLEN(FEATURE_SIMULATE_PREFIX);
+  int32_t days = SIMULATE_DEFAULT_DAYS;
+  auto days_str = httpd::query_parse_param(query_frag, PARAM_SIMULATE_DAYS, 0);
+  if (days_str) {
+    char* endptr;
+    days = strtoul(days_str->data(), &endptr, 10);
+    if (days_str->empty() || *endptr != '\0' || days <= 0 || days > SIMULATE_MAX_DAYS) {
+      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid number of days");
+      return true;
+    }
+  } else if (days_str.error() != ESP_ERR_NOT_FOUND) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid number of days");
+    return true;
+  }
+
+  _simulate_schedule(days, req);
+  return true;
+}
+
+//----------------------
+// Keyframe Plan Subfunction
+
+inline constexpr char FEATURE_PLAN_PREFIX[] = "/plan";
+
+std::string _print_keyframe(uint32_t start_ms, const Keyframe& keyframe) {
+  utils::DataBuf print_buf(64);
+  std::string result = print_buf.PrintTo("%8u +%-7u ", start_ms, keyframe.duration_ms);
+  switch (keyframe.type) {
+    case Keyframe::Type::NOOP:
+      result.append("noop");
+      break;
+    case Keyframe::Type::UNIFORM_COLOR:
+      result.append("uniform ").append(lightshow::to_string(keyframe.color));
+      break;
+    case Keyframe::Type::COLOR_WIPE:
+      result.append("wipe ").append(lightshow::to_string(keyframe.color));
+      result.append(
+          (keyframe.direction == Config::Transition::ColorWipe::Direction::RightToLeft) ? " <--"
+                                                                                        : " -->");
+      result.append(print_buf.PrintTo(" %d.%03d", keyframe.blade_width / 1000,
+                                      keyframe.blade_width % 1000));
+      break;
+  }
+  return result.append("\n");
+}
+
+// List the keyframes planned for a transition, one per line: start time and duration
+// (in ms), target type and parameters. The output is stable for the same input, so it
+// can be diffed against a known-good copy.
+// Each keyframe is sent as it is planned, so a long show is never held in memory.
+// Note that nothing is rendered, the pixels produced by LightShow are not covered.
+esp_err_t _dump_keyframe_plan(httpd_req_t* req) {
+  utils::AutoReleaseRes<cJSON*> json;
+  if (httpd::receive_json(req, json) != ESP_OK) {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Failed to receive transition data");
+  }
+  auto transition = parse_transition(*json, true);
+  if (!transition) {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid transition data");
+  }
+
+  ESP_RETURN_ON_ERROR(httpd_resp_set_type(req, HTTP_MIME_TEXT));
+  uint32_t count = 0, start_ms = 0;
+  esp_err_t err = PlanTransition(*transition, [&](const Keyframe& keyframe) {
+    std::string keyframe_str = _print_keyframe(start_ms, keyframe);
+    ESP_RETURN_ON_ERROR(httpd_resp_send_chunk(req, keyframe_str.data(), keyframe_str.length()));
+    ++count;
+    start_ms += keyframe.duration_ms;
+    return ESP_OK;
+  });
+  if (err != ESP_OK) {
+    ESP_RETURN_ON_ERROR(
+        httpd_resp_send_chunk(req, "Failed to plan transition!\n", HTTPD_RESP_USE_STRLEN));
+  }
+
+  utils::DataBuf summary_buf(64);
+  ESP_RETURN_ON_ERROR(httpd_resp_send_chunk(
+      req, summary_buf.PrintTo("--- %u keyframes over %u ms ---\n", count, start_ms),
+      HTTPD_RESP_USE_STRLEN));
+  return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+bool _subfunc_plan(const char* feature, httpd_req_t* req) {
+  if (strncmp(feature, FEATURE_PLAN_PREFIX, utils::STRLEN(FEATURE_PLAN_PREFIX)) != 0)
+    return false;
+
+  if (req->method != HTTP_POST) {
+    httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Unexpected method");
+    return true;
+  }
+
+  _dump_keyframe_plan(req);
+  return true;
+}
+
+//----------------------
+// Stats Subfunction
+
+inline constexpr char FEATURE_STATS_PREFIX[] = "/stats";
+
+inline constexpr char PARAM_STATS_RESET[] = "reset";
+
+cJSON* _add_histogram(cJSON* json, const char* name, const LightShowStats::Histogram& histogram) {
+  cJSON* array = cJSON_AddArrayToObject(json, name);
+  if (array == NULL) return NULL;
+  for (uint32_t count : histogram) {
+    cJSON* item = cJSON_CreateNumber(count);
+    if (item == NULL) return NULL;
+    cJSON_AddItemToArray(array, item);
+  }
+  return array;
+}
+
+esp_err_t _marshal_transition_stats(const LightShowStats::TransitionStats& transition_stats,
+                                    const char* name, cJSON* json) {
+  cJSON* item = cJSON_AddObjectToObject(json, name);
+  if (item == NULL) return ESP_ERR_NO_MEM;
+  if (cJSON_AddNumberToObject(item, "batches", transition_stats.batches) == NULL ||
+      cJSON_AddNumberToObject(item, "underflows", transition_stats.underflows) == NULL ||
+      cJSON_AddNumberToObject(item, "near_misses", transition_stats.near_misses) == NULL)
+    return ESP_ERR_NO_MEM;
+  return ESP_OK;
+}
+
+esp_err_t _marshal_stats(const LightShowStats& stats, cJSON* json) {
+  cJSON* transitions = cJSON_AddObjectToObject(json, "transitions");
+  if (transitions == NULL) return ESP_ERR_NO_MEM;
+  for (size_t type = 1; type < LightShowStats::NUM_TRANSITION_TYPES; ++type) {
+    ESP_RETURN_ON_ERROR(_marshal_transition_stats(
+        stats.transitions[type],
+        print_transition_type(static_cast<Config::Transition::Type>(type)).c_str(),
+        transitions));
+  }
+  ESP_RETURN_ON_ERROR(_marshal_transition_stats(stats.mixed_transitions, "mixed", transitions));
+
+  if (_add_histogram(json, "batch_transitions", stats.batch_transitions) == NULL ||
+      _add_histogram(json, "batch_overrun_ms", stats.batch_overrun_ms) == NULL ||
+      _add_histogram(json, "batch_wait_wakeups", stats.batch_wait_wakeups) == NULL ||
+      _add_histogram(json, "queue_depth_ms", stats.queue_depth_ms) == NULL)
+    return ESP_ERR_NO_MEM;
+
+  if (stats.has_isr_stats) {
+    cJSON* isr = cJSON_AddObjectToObject(json, "isr");
+    if (isr == NULL) return ESP_ERR_NO_MEM;
+    if (cJSON_AddNumberToObject(isr, "latency_low_us", stats.isr_latency_low_us) == NULL ||
+        cJSON_AddNumberToObject(isr, "latency_high_us", stats.isr_latency_high_us) == NULL ||
+        _add_histogram(isr, "latency_us", stats.isr_latency_us) == NULL ||
+        cJSON_AddNumberToObject(isr, "late_wakeups", stats.isr_late_wakeups) == NULL)
+      return ESP_ERR_NO_MEM;
+  }
+
+  if (cJSON_AddNumberToObject(json, "renderer_fps", stats.renderer_fps) == NULL ||
+      cJSON_AddNumberToObject(json, "max_fps", stats.max_fps) == NULL ||
+      cJSON_AddBoolToObject(json, "driver_suspended", stats.driver_suspended) == NULL ||
+      cJSON_AddNumberToObject(json, "suppressed_frames", stats.suppressed_frames) == NULL ||
+      cJSON_AddNumberToObject(json, "wakeups_per_hour", stats.wakeups_per_hour) == NULL)
+    return ESP_ERR_NO_MEM;
+  return ESP_OK;
+}
+
+void _get_stats(bool reset, httpd_req_t* req) {
+  auto stats = GetLightShowStats(reset);
+  if (!stats) {
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Error fetching stats");
+    return;
+  }
+
+  utils::AutoReleaseRes<cJSON*> json(cJSON_CreateObject(), cJSON_Delete);
+  if (*json == nullptr || _marshal_stats(*stats, *json) != ESP_OK) {
+    ESP_LOGD(TAG, "Failed to marshal stats");
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Error marshalling stats");
+    return;
+  }
+  httpd::send_json(req, *json);
+}
+
+bool _subfunc_stats(const char* feature, httpd_req_t* req) {
+  if (strncmp(feature, FEATURE_STATS_PREFIX, utils::STRLEN(FEATURE_STATS_PREFIX)) != 0)
+    return false;
+
+  if (req->method != HTTP_GET) {
+    httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Unexpected method");
+    return true;
+  }
+
+  const char* query_frag = feature + utils::STRLEN(FEATURE_STATS_PREFIX);
+  bool reset = static_cast<bool>(httpd::query_parse_param(query_frag, PARAM_STATS_RESET, 0));
+  _get_stats(reset, req);
+  return true;
+}
+
+const std::vector<SubFuncHandler> subfunc_ = {_subfunc_setup, _subfunc_override,
+                                              _subfunc_simulate, _subfunc_plan, _subfunc_stats};
 
 esp_err_t _handler_twilight(httpd_req_t* req) {
   ESP_LOGI(TAG, "[%s] %s", http_method_str((enum http_method)req->method), req->uri);
@@ -20,6 +20,7 @@ struct Config {
       UNIFORM_COLOR,
       COLOR_WIPE,
       COLOR_WHEEL,
+      KEYFRAME_SHOW,
     } type;
 
     uint32_t duration_ms;
@@ -28,26 +29,34 @@ struct Config {
       lightshow::RGB888 color;
     };
 
+    // Fractional parameters are fixed-point, in units of 1/1000.
     struct ColorWipe {
       enum class Direction {
         UNSPECIFIED = 0,
         LeftToRight,
         RightToLeft,
       } direction;
-      float blade_width;
+      uint16_t blade_width;  // Fraction of the strip length
       lightshow::RGB888 color;
     };
 
     struct ColorWheel {
-      uint16_t start_hue;
-      float wheel_width;
-      uint16_t intensity;
+      uint16_t start_hue;    // In degrees
+      uint16_t wheel_width;  // Fraction of the hue circle to fade through, over time
+      uint16_t intensity;    // In percent
+    };
+
+    // A precompiled show file, streamed from the storage partition.
+    // The transition duration only serves as an estimate for scheduling.
+    struct KeyframeShow {
+      char file[24];  // File name, under `/shows/`
     };
 
     union {
       UniformColor uniform_color;
       ColorWipe color_wipe;
       ColorWheel color_wheel;
+      KeyframeShow keyframe_show;
     };
 
     operator bool() const { return duration_ms > 0; }
@@ -2,6 +2,10 @@
 #ifndef APP_TWILIGHT_INTERFACE_PRIVATE
 #define APP_TWILIGHT_INTERFACE_PRIVATE
 
+#include <array>
+#include <functional>
+#include <vector>
+
 #include "esp_err.h"
 #include "cJSON.h"
 
@@ -22,6 +26,7 @@ extern utils::DataOrError<Config::TransitionsMap> parse_transitions_map(const cJ
 extern utils::DataOrError<Config::EventsList> parse_events_list(const cJSON* json, bool strict);
 
 extern std::string print_time(uint16_t time);
+extern std::string print_transition_type(Config::Transition::Type type);
 extern std::string print_event(const Config::Event& event);
 
 struct ConfigState {
@@ -31,19 +36,96 @@ struct ConfigState {
 
 extern utils::DataOrError<ConfigState> GetConfigState(void);
 
+class EventTimeline;
+
+// Copy the event timeline compiled from the saved config.
+extern esp_err_t CopyEventTimeline(EventTimeline& timeline);
+
+// Runs when no configured event is in effect, and in place of unknown event transitions.
+extern const Config::Transition TWILIGHT_NO_CONFIG_TRANSITION;
+
+// Transitions of each configured event, resolved by name. Event `i` runs
+// `transitions[start[i]]` up to that of event `i + 1`.
+struct EventTransitions {
+  std::vector<const Config::Transition*> transitions;
+  std::vector<uint16_t> start;
+};
+
+// Resolve the transitions that each event of `config` queues; they point into `config`.
+extern void ResolveEventTransitions(const Config& config, EventTransitions& resolved);
+
+// Light show telemetry, accumulated since boot or the last reset.
+struct LightShowStats {
+  static constexpr size_t NUM_TRANSITION_TYPES =
+      static_cast<size_t>(Config::Transition::Type::KEYFRAME_SHOW) + 1;
+  // Bucket 0 counts zeros, bucket `i` counts values in [2^(i-1), 2^i),
+  // and the last bucket also counts everything beyond.
+  static constexpr size_t HISTOGRAM_BUCKETS = 12;
+  using Histogram = std::array<uint32_t, HISTOGRAM_BUCKETS>;
+
+  // Driver observations cover a whole batch, so they are attributed to a transition type
+  // only from batches of that type alone; batches mixing types are counted as mixed.
+  struct TransitionStats {
+    uint32_t batches;
+    uint32_t underflows;
+    uint32_t near_misses;
+  };
+  std::array<TransitionStats, NUM_TRANSITION_TYPES> transitions;
+  TransitionStats mixed_transitions;
+
+  Histogram batch_transitions;   // Number of transitions queued per batch
+  Histogram batch_overrun_ms;    // Time taken by a batch beyond its scheduled durations
+  Histogram batch_wait_wakeups;  // Service task wake-ups while waiting for a batch
+  Histogram queue_depth_ms;      // Playback time queued in the renderer, as keyframes are fed
+
+  bool has_isr_stats;  // ISR latencies are only tracked in ISR development builds
+  uint32_t isr_latency_low_us;   // Lowest across batches
+  uint32_t isr_latency_high_us;  // Highest across batches
+  Histogram isr_latency_us;      // Highest of each batch
+  uint32_t isr_late_wakeups;
+
+  uint32_t wakeups_per_hour;
+  uint8_t renderer_fps;  // Current (adaptive) frame rate of the renderer
+  uint8_t max_fps;       // Frame rate cap, lowered while the driver struggles
+
+  bool driver_suspended;       // The strip is settled, and no frames are being pushed
+  uint32_t suppressed_frames;  // Frames not pushed while the driver was suspended
+};
+
+extern utils::DataOrError<LightShowStats> GetLightShowStats(bool reset);
+
+// A renderer target planned for a transition.
+struct Keyframe {
+  enum class Type : uint8_t {
+    NOOP,
+    UNIFORM_COLOR,
+    COLOR_WIPE,
+  } type;
+
+  uint32_t duration_ms;
+  lightshow::RGB888 color;
+  // Color wipe only
+  uint16_t blade_width;  // Fixed-point, in units of 1/1000 of the strip length
+  Config::Transition::ColorWipe::Direction direction;
+};
+using KeyframeSink = std::function<esp_err_t(const Keyframe&)>;
+
+// Plan the renderer targets of a transition, without touching the strip.
+extern esp_err_t PlanTransition(const Config::Transition& transition, const KeyframeSink& sink);
+
 inline constexpr int32_t SECONDS_IN_A_MINUTE = 60;
 inline constexpr int32_t SECONDS_IN_AN_HOUR = 60 * SECONDS_IN_A_MINUTE;
 inline constexpr int32_t SECONDS_IN_A_DAY = 24 * SECONDS_IN_AN_HOUR;
 
-inline constexpr int32_t PRECOMPUTE_WINDOW = 4 * SECONDS_IN_AN_HOUR;  // Look 4 hours ahead
-static_assert(PRECOMPUTE_WINDOW < SECONDS_IN_A_DAY);
+// Upper bound of configured events, as the event sequencer tracks them in bit masks.
+inline constexpr size_t MAX_EVENTS = 256;
 
 inline constexpr int16_t EVENT_IDX_UNCONFIGURED = -1;
 inline constexpr int16_t EVENT_IDX_MANUAL_OVERRIDE = -2;
 inline constexpr int16_t EVENT_IDX_UNINITIALIZED = -3;
 
 struct EventEntry {
-  int32_t completion;  // Completion time of this event
+  int64_t completion;  // Completion time of this event (in local seconds)
   int16_t event_idx;   // >=0 : Event index in `config.events`; otherwise, see `EVENT_IDX_`
 };
 
@@ -58,6 +140,9 @@ extern utils::ESPErrorStatus Set_Events(Config::EventsList&& events);
 
 extern utils::ESPErrorStatus Perform_Override(int32_t duration, Config::Transition&& transition);
 
+// Play keyframes from a live stream, which preempts the schedule until it goes quiet.
+extern utils::ESPErrorStatus Perform_Live(const Keyframe* keyframes, size_t count);
+
 }  // namespace zw::esp8266::app::twilight
 
 #endif  // APP_TWILIGHT_INTERFACE_PRIVATE
@@ -0,0 +1,130 @@
+#include "KeyframePlan.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "esp_log.h"
+
+#include "ZWUtils.hpp"
+
+#include "KeyframeShow.hpp"
+
+namespace zw::esp8266::app::twilight {
+namespace {
+
+inline constexpr char TAG[] = "TWiLight-Plan";
+
+namespace LS = ::zw::esp8266::lightshow;
+
+// Full-saturation, full-brightness colors of each hue degree, packed as 0x00RRGGBB.
+// Packed into words so that a lookup is a single aligned read from flash.
+constexpr std::array<uint32_t, 360> _make_hue_table(void) {
+  std::array<uint32_t, 360> table = {};
+  for (uint32_t hue = 0; hue < 360; ++hue) {
+    const uint32_t rise = (hue % WHEEL_SECTOR_DEGREES) * 0xFF / WHEEL_SECTOR_DEGREES;
+    const uint32_t fall = 0xFF - rise;
+    switch (hue / WHEEL_SECTOR_DEGREES) {
+      case 0:
+        table[hue] = 0xFF0000 | rise << 8;
+        break;
+      case 1:
+        table[hue] = fall << 16 | 0x00FF00;
+        break;
+      case 2:
+        table[hue] = 0x00FF00 | rise;
+        break;
+      case 3:
+        table[hue] = fall << 8 | 0x0000FF;
+        break;
+      case 4:
+        table[hue] = rise << 16 | 0x0000FF;
+        break;
+      default:
+        table[hue] = 0xFF0000 | fall;
+    }
+  }
+  return table;
+}
+inline constexpr std::array<uint32_t, 360> HUE_TABLE = _make_hue_table();
+
+}  // namespace
+
+LS::RGB888 hue_color(uint32_t hue, uint8_t value) {
+  const uint32_t color = HUE_TABLE[hue % 360];
+  const uint32_t scale = value + 1;
+  return {(uint8_t)(((color >> 16) & 0xFF) * scale >> 8),
+          (uint8_t)(((color >> 8) & 0xFF) * scale >> 8), (uint8_t)((color & 0xFF) * scale >> 8)};
+}
+
+uint8_t color_wheel_value(const Config::Transition::ColorWheel& params) {
+  return std::min<uint32_t>(params.intensity, 100) * 255 / 100;
+}
+
+uint32_t color_wheel_degrees(const Config::Transition::ColorWheel& params) {
+  return (uint32_t)params.wheel_width * 360 / 1000;
+}
+
+LS::RGB888 color_wheel_end(const Config::Transition::ColorWheel& params) {
+  return hue_color(params.start_hue + color_wheel_degrees(params), color_wheel_value(params));
+}
+
+esp_err_t plan_color_wheel(uint32_t duration_ms, const Config::Transition::ColorWheel& params,
+                           const KeyframeSink& sink) {
+  const uint8_t value = color_wheel_value(params);
+  const uint32_t wheel_degrees = color_wheel_degrees(params);
+  const uint32_t total_degrees = wheel_degrees + WHEEL_SECTOR_DEGREES;
+
+  uint32_t hue = params.start_hue;
+  uint32_t elapsed_ms = (uint64_t)duration_ms * WHEEL_SECTOR_DEGREES / total_degrees;
+  ESP_RETURN_ON_ERROR(sink({.type = Keyframe::Type::UNIFORM_COLOR,
+                            .duration_ms = elapsed_ms,
+                            .color = hue_color(hue, value)}));
+  for (uint32_t turned = 0; turned < wheel_degrees;) {
+    const uint32_t step = std::min<uint32_t>(WHEEL_SECTOR_DEGREES - hue % WHEEL_SECTOR_DEGREES,
+                                             wheel_degrees - turned);
+    hue += step;
+    turned += step;
+    // Derive keyframe times from the total, so that rounding errors do not accumulate
+    const uint32_t next_ms =
+        (uint64_t)duration_ms * (turned + WHEEL_SECTOR_DEGREES) / total_degrees;
+    ESP_RETURN_ON_ERROR(sink({.type = Keyframe::Type::UNIFORM_COLOR,
+                              .duration_ms = next_ms - elapsed_ms,
+                              .color = hue_color(hue, value)}));
+    elapsed_ms = next_ms;
+  }
+  return ESP_OK;
+}
+
+esp_err_t PlanTransition(const Config::Transition& transition, const KeyframeSink& sink) {
+  switch (transition.type) {
+    case Config::Transition::Type::UNIFORM_COLOR: {
+      ESP_RETURN_ON_ERROR(sink({.type = Keyframe::Type::UNIFORM_COLOR,
+                                .duration_ms = transition.duration_ms,
+                                .color = transition.uniform_color.color}));
+    } break;
+
+    case Config::Transition::Type::COLOR_WIPE: {
+      const auto& params = transition.color_wipe;
+      ESP_RETURN_ON_ERROR(sink({.type = Keyframe::Type::COLOR_WIPE,
+                                .duration_ms = transition.duration_ms,
+                                .color = params.color,
+                                .blade_width = params.blade_width,
+                                .direction = params.direction}));
+    } break;
+
+    case Config::Transition::Type::COLOR_WHEEL: {
+      ESP_RETURN_ON_ERROR(plan_color_wheel(transition.duration_ms, transition.color_wheel, sink));
+    } break;
+
+    case Config::Transition::Type::KEYFRAME_SHOW: {
+      ESP_RETURN_ON_ERROR(StreamKeyframeShow(transition.keyframe_show.file, sink));
+    } break;
+
+    default:
+      ESP_LOGW(TAG, "Unrecognized transition type");
+  }
+
+  return ESP_OK;
+}
+
+}  // namespace zw::esp8266::app::twilight
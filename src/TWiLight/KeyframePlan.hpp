@@ -0,0 +1,45 @@
+// Keyframe planning of transitions for TWiLight
+
+// Note that this header intentionally doesn't have `#ifndef *_H`
+// or `pragma once`. This is because it is an internal unit to
+// the local module, never intended to be included anywhere else.
+// If the module offers features for external used, it will put
+// them in the `Interface.h`.
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "LSPixel.hpp"
+
+#include "Interface.hpp"
+#include "Interface_Private.hpp"
+
+namespace zw::esp8266::app::twilight {
+
+// The color wheel is planned in sectors of this many hue degrees, within which only
+// one color channel changes, linearly with hue.
+inline constexpr uint32_t WHEEL_SECTOR_DEGREES = 60;
+
+// Color of `hue` (in degrees) at `value` brightness: one table read, and a multiply-shift
+// per channel. Each channel is within 2 of the exact HSV conversion.
+lightshow::RGB888 hue_color(uint32_t hue, uint8_t value);
+
+// Brightness of a color wheel, from its intensity in percent.
+uint8_t color_wheel_value(const Config::Transition::ColorWheel& params);
+
+// Hue degrees a color wheel turns through, from its `wheel_width`.
+uint32_t color_wheel_degrees(const Config::Transition::ColorWheel& params);
+
+// The uniform color a color wheel leaves the strip in.
+lightshow::RGB888 color_wheel_end(const Config::Transition::ColorWheel& params);
+
+// The color wheel is a uniform color fading through the hue circle over time; all pixels
+// show the same hue. It is planned as uniform color keyframes on sector boundaries, which
+// the renderer's blending connects into the exact wheel, so the hue table is only read
+// once per keyframe, never per pixel or frame. The strip first blends into the start hue,
+// at the pace of a sector.
+esp_err_t plan_color_wheel(uint32_t duration_ms, const Config::Transition::ColorWheel& params,
+                           const KeyframeSink& sink);
+
+}  // namespace zw::esp8266::app::twilight
@@ -0,0 +1,103 @@
+#include "KeyframeShow.hpp"
+
+#include <algorithm>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+
+#include "ZWUtils.hpp"
+#include "ZWAppConfig.h"
+
+namespace zw::esp8266::app::twilight {
+namespace {
+
+inline constexpr char TAG[] = "TWiLight-Show";
+
+inline constexpr char SHOW_MAGIC[] = {'T', 'W', 'K', 'S'};
+inline constexpr uint8_t SHOW_VERSION = 1;
+inline constexpr size_t SHOW_HEADER_SIZE = 8;
+// Number of keyframes read from flash at a time.
+inline constexpr size_t SHOW_READ_KEYFRAMES = 8;
+
+uint16_t _get_u16(const uint8_t* data) { return data[0] | data[1] << 8; }
+
+uint32_t _get_u32(const uint8_t* data) { return _get_u16(data) | _get_u16(data + 2) << 16; }
+
+std::string _show_file_path(const char* file_name) {
+  std::string file_path(ZW_STORAGE_MOUNT_POINT);
+  return file_path.append(SHOW_FILE_DIR).append(file_name);
+}
+
+}  // namespace
+
+utils::DataOrError<Keyframe> DecodeKeyframe(const uint8_t* data) {
+  Keyframe keyframe = {};
+  switch (data[0]) {
+    case 0:
+      keyframe.type = Keyframe::Type::NOOP;
+      break;
+    case 1:
+      keyframe.type = Keyframe::Type::UNIFORM_COLOR;
+      break;
+    case 2:
+      keyframe.type = Keyframe::Type::COLOR_WIPE;
+      break;
+    default:
+      ESP_LOGD(TAG, "Unrecognized keyframe type %d", data[0]);
+      return ESP_ERR_NOT_SUPPORTED;
+  }
+  keyframe.direction = data[1] ? Config::Transition::ColorWipe::Direction::RightToLeft
+                               : Config::Transition::ColorWipe::Direction::LeftToRight;
+  keyframe.blade_width = _get_u16(data + 2);
+  keyframe.duration_ms = _get_u32(data + 4);
+  keyframe.color = {data[8], data[9], data[10]};
+  return keyframe;
+}
+
+size_t GetKeyframeShowSize(const char* file_name) {
+  struct stat file_stat;
+  if (stat(_show_file_path(file_name).c_str(), &file_stat) != 0) return 0;
+  return S_ISREG(file_stat.st_mode) ? file_stat.st_size : 0;
+}
+
+esp_err_t StreamKeyframeShow(const char* file_name, const KeyframeSink& sink) {
+  std::string file_path = _show_file_path(file_name);
+  utils::AutoReleaseRes<FILE*> file(fopen(file_path.c_str(), "r"), [](FILE* file) {
+    if (file) fclose(file);
+  });
+  if (*file == NULL) {
+    ESP_LOGW(TAG, "Unable to open show '%s'", file_name);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  uint8_t header[SHOW_HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), *file) != sizeof(header) ||
+      memcmp(header, SHOW_MAGIC, sizeof(SHOW_MAGIC)) != 0) {
+    ESP_LOGW(TAG, "Show '%s' is malformed", file_name);
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (header[4] != SHOW_VERSION) {
+    ESP_LOGW(TAG, "Show '%s' has unsupported version %d", file_name, header[4]);
+    return ESP_ERR_INVALID_VERSION;
+  }
+
+  uint8_t buffer[SHOW_READ_KEYFRAMES * SHOW_KEYFRAME_SIZE];
+  for (size_t remaining = _get_u16(header + 6); remaining > 0;) {
+    const size_t count = std::min(remaining, SHOW_READ_KEYFRAMES);
+    if (fread(buffer, SHOW_KEYFRAME_SIZE, count, *file) != count) {
+      ESP_LOGW(TAG, "Show '%s' is truncated", file_name);
+      return ESP_ERR_INVALID_SIZE;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      ASSIGN_OR_RETURN(Keyframe keyframe, DecodeKeyframe(buffer + i * SHOW_KEYFRAME_SIZE));
+      ESP_RETURN_ON_ERROR(sink(keyframe));
+    }
+    remaining -= count;
+  }
+  return ESP_OK;
+}
+
+}  // namespace zw::esp8266::app::twilight
@@ -0,0 +1,45 @@
+// Keyframe show files for TWiLight
+
+// Note that this header intentionally doesn't have `#ifndef *_H`
+// or `pragma once`. This is because it is an internal unit to
+// the local module, never intended to be included anywhere else.
+// If the module offers features for external used, it will put
+// them in the `Interface.h`.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "ZWUtils.hpp"
+
+#include "Interface_Private.hpp"
+
+namespace zw::esp8266::app::twilight {
+
+// Show files live in this directory of the storage partition.
+inline constexpr char SHOW_FILE_DIR[] = "/shows/";
+
+inline constexpr size_t SHOW_KEYFRAME_SIZE = 12;
+
+// A show file is a precompiled sequence of keyframes (all integers little-endian):
+//
+//   Header (8 bytes):
+//     "TWKS", version (u8, currently 1), reserved (u8), number of keyframes (u16)
+//   Keyframe (12 bytes each):
+//     type (u8; 0 = no-op, 1 = uniform color, 2 = color wipe),
+//     wipe direction (u8; 0 = left to right, 1 = right to left),
+//     wipe blade width (u16; in 1/1000 of the strip length),
+//     duration (u32; in ms), color (r, g, b; u8 each), reserved (u8)
+//
+// Keyframes are read from flash a few at a time, and passed on to `sink`, so the
+// file is never loaded as a whole.
+// Size of a show file in bytes, 0 if it does not exist.
+size_t GetKeyframeShowSize(const char* file_name);
+
+esp_err_t StreamKeyframeShow(const char* file_name, const KeyframeSink& sink);
+
+// Decode a single keyframe record of `SHOW_KEYFRAME_SIZE` bytes.
+utils::DataOrError<Keyframe> DecodeKeyframe(const uint8_t* data);
+
+}  // namespace zw::esp8266::app::twilight
@@ -0,0 +1,237 @@
+#include "LiveStream.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#include "lwip/sockets.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "ZWUtils.hpp"
+
+#include "AppEventMgr/Interface.hpp"
+
+#include "Interface_Private.hpp"
+#include "KeyframeShow.hpp"
+
+#define LIVE_STREAM_MAX_KEYFRAMES 16
+// Number of datagrams held for reordering.
+#define LIVE_STREAM_SLOTS 4
+// How long a datagram is held for the ones missing before it.
+#define LIVE_STREAM_JITTER_MS 40
+// A stream is considered ended after being quiet for this long.
+#define LIVE_STREAM_IDLE_MS 2000
+
+namespace zw::esp8266::app::twilight {
+namespace {
+
+inline constexpr char TAG[] = "TWiLight-Live";
+
+inline constexpr char LIVE_MAGIC[] = {'T', 'W', 'L', 'S'};
+inline constexpr size_t LIVE_HEADER_SIZE = 8;
+inline constexpr size_t LIVE_DATAGRAM_LIMIT =
+    LIVE_HEADER_SIZE + LIVE_STREAM_MAX_KEYFRAMES * SHOW_KEYFRAME_SIZE;
+
+struct Datagram {
+  uint8_t data[LIVE_DATAGRAM_LIMIT];
+  uint16_t sequence;
+  TickType_t arrival;
+};
+
+struct StreamStats {
+  uint32_t played;
+  uint32_t lost;      // Never arrived within the jitter window
+  uint32_t late;      // Arrived after the jitter window, or duplicated
+  uint32_t rejected;  // Refused by the light show
+};
+
+// Datagrams are received in place, and reordering only moves pointers around.
+class JitterBuffer {
+ public:
+  JitterBuffer(void) {
+    for (Datagram& datagram : datagrams_) free_[free_count_++] = &datagram;
+  }
+
+  bool started(void) const { return started_; }
+
+  // A datagram buffer to receive into, always available.
+  Datagram* Receiving(void) { return free_[free_count_ - 1]; }
+
+  // Take the datagram last received into `Receiving()`.
+  void Accept(uint16_t sequence) {
+    if (!started_) {
+      started_ = true;
+      next_ = sequence;
+    }
+    const int16_t ahead = sequence - next_;
+    if (ahead < 0 || (ahead < LIVE_STREAM_SLOTS && slots_[sequence % LIVE_STREAM_SLOTS])) {
+      ++stats_.late;
+      return;
+    }
+
+    Datagram* datagram = free_[--free_count_];
+    if (ahead >= LIVE_STREAM_SLOTS) {
+      // Too far ahead, give up waiting for the gap.
+      while (held_count_ > 0 && (uint16_t)(sequence - next_) >= LIVE_STREAM_SLOTS) _advance();
+      if ((uint16_t)(sequence - next_) >= LIVE_STREAM_SLOTS) {
+        stats_.lost += (uint16_t)(sequence - next_);
+        next_ = sequence;
+      }
+    }
+    datagram->sequence = sequence;
+    datagram->arrival = xTaskGetTickCount();
+    slots_[sequence % LIVE_STREAM_SLOTS] = datagram;
+    ++held_count_;
+  }
+
+  // Play all datagrams that are due.
+  void Drain(void) {
+    while (held_count_ > 0) {
+      if (slots_[next_ % LIVE_STREAM_SLOTS] == nullptr && HoldTicks() > 0) break;
+      _advance();
+    }
+  }
+
+  // How long until the oldest held datagram is due, or `portMAX_DELAY` if none is held.
+  TickType_t HoldTicks(void) const {
+    if (held_count_ == 0) return portMAX_DELAY;
+    TickType_t oldest_held = 0;
+    const TickType_t now = xTaskGetTickCount();
+    for (const Datagram* datagram : slots_) {
+      if (datagram != nullptr) oldest_held = std::max(oldest_held, now - datagram->arrival);
+    }
+    const TickType_t jitter_ticks = LIVE_STREAM_JITTER_MS / portTICK_PERIOD_MS;
+    return (oldest_held < jitter_ticks) ? jitter_ticks - oldest_held : 0;
+  }
+
+  // End the stream; any datagram still held is played.
+  StreamStats Finish(void) {
+    while (held_count_ > 0) _advance();
+    StreamStats stats = stats_;
+    stats_ = {};
+    started_ = false;
+    return stats;
+  }
+
+ private:
+  // Play the next datagram in sequence, or account it lost.
+  void _advance(void) {
+    Datagram*& slot = slots_[next_++ % LIVE_STREAM_SLOTS];
+    if (slot == nullptr) {
+      ++stats_.lost;
+      return;
+    }
+    if (_play(*slot) == ESP_OK) {
+      ++stats_.played;
+    } else {
+      ++stats_.rejected;
+    }
+    free_[free_count_++] = slot;
+    slot = nullptr;
+    --held_count_;
+  }
+
+  static esp_err_t _play(const Datagram& datagram) {
+    Keyframe keyframes[LIVE_STREAM_MAX_KEYFRAMES];
+    const uint8_t count = datagram.data[6];
+    for (uint8_t i = 0; i < count; ++i) {
+      ASSIGN_OR_RETURN(keyframes[i],
+                       DecodeKeyframe(datagram.data + LIVE_HEADER_SIZE + i * SHOW_KEYFRAME_SIZE));
+    }
+    auto result = Perform_Live(keyframes, count);
+    if (!result) {
+      ESP_LOGD(TAG, "Datagram %d refused: %s", datagram.sequence, result.message.c_str());
+      return ESP_FAIL;
+    }
+    return ESP_OK;
+  }
+
+  Datagram datagrams_[LIVE_STREAM_SLOTS + 1];
+  Datagram* free_[LIVE_STREAM_SLOTS + 1];
+  size_t free_count_ = 0;
+  Datagram* slots_[LIVE_STREAM_SLOTS] = {};
+  size_t held_count_ = 0;
+
+  bool started_ = false;
+  uint16_t next_ = 0;
+  StreamStats stats_ = {};
+};
+
+bool _valid_datagram(const uint8_t* data, ssize_t size) {
+  if (size < (ssize_t)LIVE_HEADER_SIZE || memcmp(data, LIVE_MAGIC, sizeof(LIVE_MAGIC)) != 0) {
+    return false;
+  }
+  const uint8_t count = data[6];
+  return count <= LIVE_STREAM_MAX_KEYFRAMES &&
+         size == (ssize_t)(LIVE_HEADER_SIZE + count * SHOW_KEYFRAME_SIZE);
+}
+
+void _set_receive_timeout(int sock, TickType_t ticks) {
+  // Note that a zero timeout would block indefinitely.
+  ticks = std::clamp<TickType_t>(ticks, 1, LIVE_STREAM_IDLE_MS / portTICK_PERIOD_MS);
+  const uint32_t timeout_ms = ticks * portTICK_PERIOD_MS;
+  struct timeval timeout = {};
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_usec = timeout_ms % 1000 * 1000;
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+}  // namespace
+
+void live_stream_task(void*) {
+  utils::AutoReleaseRes<int> server_sock(socket(AF_INET, SOCK_DGRAM, 0), [](int sock) {
+    if (sock != -1) close(sock);
+  });
+  if (*server_sock == -1) {
+    ESP_LOGE(TAG, "Failed to create socket");
+    eventmgr::SetSystemFailed();
+    return;
+  }
+
+  struct sockaddr_in server_addr = {};
+  server_addr.sin_family = AF_INET;
+  server_addr.sin_addr.s_addr = INADDR_ANY;
+  server_addr.sin_port = htons(LIVE_STREAM_PORT);
+  server_addr.sin_len = sizeof(server_addr);
+
+  if (bind(*server_sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) != 0) {
+    if (errno == EADDRINUSE) {
+      ESP_LOGW(TAG, "Live stream already listening");
+      return;
+    }
+    ESP_LOGE(TAG, "Failed to start listening");
+    eventmgr::SetSystemFailed();
+    return;
+  }
+
+  // The buffer is too large for the task stack.
+  static JitterBuffer jitter_buffer;
+  ESP_LOGD(TAG, "Listening for live stream on port %d...", LIVE_STREAM_PORT);
+  while (!eventmgr::IsSystemFailed()) {
+    _set_receive_timeout(*server_sock, jitter_buffer.HoldTicks());
+    Datagram* datagram = jitter_buffer.Receiving();
+    ssize_t size = recv(*server_sock, datagram->data, LIVE_DATAGRAM_LIMIT, 0);
+    if (size > 0) {
+      if (!_valid_datagram(datagram->data, size)) {
+        ESP_LOGD(TAG, "Malformed datagram (%d bytes)", size);
+        continue;
+      }
+      if (!jitter_buffer.started()) ESP_LOGI(TAG, "Live stream started");
+      jitter_buffer.Accept(datagram->data[4] | datagram->data[5] << 8);
+    } else if (jitter_buffer.started() && jitter_buffer.HoldTicks() == portMAX_DELAY) {
+      // Quiet for the whole idle period.
+      StreamStats stats = jitter_buffer.Finish();
+      ESP_LOGI(TAG, "Live stream ended: %d played, %d lost, %d late, %d rejected", stats.played,
+               stats.lost, stats.late, stats.rejected);
+      continue;
+    }
+    jitter_buffer.Drain();
+  }
+}
+
+}  // namespace zw::esp8266::app::twilight
@@ -0,0 +1,29 @@
+// Live keyframe stream for TWiLight
+
+// Note that this header intentionally doesn't have `#ifndef *_H`
+// or `pragma once`. This is because it is an internal unit to
+// the local module, never intended to be included anywhere else.
+// If the module offers features for external used, it will put
+// them in the `Interface.h`.
+
+#include <stdint.h>
+
+namespace zw::esp8266::app::twilight {
+
+inline constexpr uint16_t LIVE_STREAM_PORT = 4048;
+
+// A live stream is a sequence of UDP datagrams (all integers little-endian):
+//
+//   Header (8 bytes):
+//     "TWLS", sequence number (u16), number of keyframes (u8), reserved (u8)
+//   Keyframes (12 bytes each):
+//     Same as the keyframes of a show file, see `KeyframeShow.hpp`
+//
+// Datagrams arriving out of order are put back in sequence within a short jitter
+// window; those arriving later than that are dropped. While datagrams keep coming,
+// the stream preempts the scheduled events, as a manual override would.
+
+// Task that receives the stream
+void live_stream_task(void*);
+
+}  // namespace zw::esp8266::app::twilight
@@ -1,10 +1,13 @@
 #include "Module.hpp"
 
+#include <algorithm>
+#include <array>
+#include <iterator>
 #include <optional>
 #include <vector>
-#include <deque>
 #include <string>
 #include <utility>
+#include <sys/time.h>
 
 #include "esp_log.h"
 #include "esp_err.h"
@@ -33,13 +36,19 @@
 #include "Config.hpp"
 #include "HTTPD_Handler.hpp"
 #include "EventSequencer.hpp"
+#include "KeyframePlan.hpp"
+#include "LiveStream.hpp"
 
 #define HTTPD_STARTUP_TIMEOUT (3 * CONFIG_FREERTOS_HZ)  // 3 sec
 
 #define TWILIGHT_DEFAULT_PIXELS 16
 #define TWILIGHT_TARGET_FPS 60
 #define TWILIGHT_RENDERER_BLEND_MODE LS::Renderer::BlendMode::SMOOTH_4X4R
-#define TWILIGHT_TASK_IDLE (CONFIG_FREERTOS_HZ / 10)
+#define TWILIGHT_TASK_UNANCHORED_IDLE CONFIG_FREERTOS_HZ       // 1 sec
+#define TWILIGHT_TASK_MAX_IDLE_SEC (15 * 60)                   // 15 min
+#define TWILIGHT_TASK_WAKEUP_REPORT (3600 * CONFIG_FREERTOS_HZ)  // 1 hour
+#define TWILIGHT_TASK_RENDER_POLL (CONFIG_FREERTOS_HZ / 20)      // 50 ms
+#define TWILIGHT_LIVE_IDLE_TIMEOUT (2 * CONFIG_FREERTOS_HZ)       // 2 sec
 
 #define TWILIGHT_LIGHTSHOW_JITTER_BUFFER_US 1800
 #define TWILIGHT_LIGHTSHOW_TASK_STACK_SIZE LS::kDefaultTaskStack
@@ -68,10 +77,28 @@ inline constexpr uint32_t TWILIGHT_PIXEL_SETUP_BLADE_FADE_MS = 3000;
 inline constexpr LS::RGB888 TWILIGHT_TRANSITION_SETUP_ON_COLOR = {0x80, 0x80, 0x80};
 inline constexpr uint32_t TWILIGHT_TRANSITION_COOLDOWN_MS = 500;
 
+// How far ahead of the playback keyframes are queued to the renderer.
+inline constexpr uint32_t TWILIGHT_RENDER_AHEAD_MS = 2000;
+
+// How long ahead of an event boundary the next event's transitions are staged.
+inline constexpr int32_t TWILIGHT_EVENT_LOOKAHEAD_MS = 500;
+
+// Frame rates the renderer adapts between; the last one is the target.
+inline constexpr uint8_t TWILIGHT_FPS_STEPS[] = {10, 15, 30, TWILIGHT_TARGET_FPS};
+inline constexpr size_t TWILIGHT_FPS_STEP_TARGET = std::size(TWILIGHT_FPS_STEPS) - 1;
+// The largest per-channel color change between frames that still looks smooth.
+inline constexpr uint32_t TWILIGHT_FPS_SMOOTH_COLOR_STEP = 2;
+// Lowering the frame rate takes this many consecutive batches asking for it, so that
+// alternating batches do not reconfigure the driver every time.
+inline constexpr uint8_t TWILIGHT_FPS_LOWER_BATCHES = 3;
+
 Config config_;
 
 inline constexpr EventBits_t TWILIGHT_STATUS_RUNNING = BIT0;
 inline constexpr EventBits_t TWILIGHT_STATUS_INTERRUPT = BIT1;
+inline constexpr EventBits_t TWILIGHT_STATUS_WAKEUP = BIT2;
+inline constexpr EventBits_t TWILIGHT_STATUS_TIME_REBASE = BIT3;
+inline constexpr EventBits_t TWILIGHT_STATUS_OVERRIDE = BIT4;
 
 inline constexpr EventBits_t TWILIGHT_STATUS_SETUP_PIXELS = BIT16;
 inline constexpr EventBits_t TWILIGHT_STATUS_SETUP_TRANSITION = BIT17;
@@ -81,39 +108,115 @@ struct {
   EventGroupHandle_t status;
   SemaphoreHandle_t strip_lock;
   SemaphoreHandle_t state_lock;
+  SemaphoreHandle_t stats_lock;     // Never held while acquiring other locks
+  SemaphoreHandle_t timeline_lock;  // Never held while acquiring other locks
 
   LS::IOConfig io_config;
   std::unique_ptr<LS::Renderer> renderer;
+  size_t renderer_pixels;
+  // Frame rate adaptation: the current step, and the highest step the driver keeps up with.
+  size_t fps_step;
+  size_t fps_step_ceiling;
+  // Consecutive batches asking for a lower frame rate, and the highest step among them.
+  uint8_t fps_lower_batches;
+  size_t fps_lower_step;
+  // The color on the strip when it is uniform and known, which allows a seamless
+  // switch of the renderer frame rate.
+  std::optional<LS::RGB888> strip_color;
+  // The driver is suspended while the strip is settled; the pixels latch the last frame.
+  bool driver_running;
+  std::optional<TickType_t> driver_suspended_at;
   TaskHandle_t service_task_handle_;
+  TaskHandle_t live_task_handle_;
 
   std::optional<Config> config_setup;
   Config::Transition test_transition;
   uint8_t test_countdown;
 
   Config::Transition manual_transition;
-  // Manual override record: {start_time, duration}
-  std::optional<std::pair<int32_t, int32_t>> manual_override;
+  // Manual override record in local seconds: {start_time, end_time (-1 if none)}
+  std::optional<std::pair<int64_t, int64_t>> manual_override;
+  // While a live stream plays: when it times out, and the keyframes queued (in ms) since
+  // `live_queued_start`, when the renderer last ran dry.
+  std::optional<TickType_t> live_until;
+  TickType_t live_queued_start;
+  uint32_t live_queued_ms;
 
   std::vector<const Config::Transition*> transitions;
-  std::deque<EventEntry> event_sequence;
+  // When staged ahead of an event boundary, the delay before the transitions start.
+  uint32_t transitions_lead_ms;
+  // Transitions of each configured event, resolved once from `config_`.
+  EventTransitions event_transitions;
+  EventTimeline timeline;
+  EventEntry current_event;
+
+  // Service task wake-up accounting
+  uint32_t wakeup_count;
+  uint32_t wakeups_per_hour;
+  TickType_t wakeup_count_since;
+
+  LightShowStats stats;
 } state_ = {};
 
-const Config::Transition TWILIGHT_NO_CONFIG_TRANSITION = {
-    .type = Config::Transition::Type::UNIFORM_COLOR,
-    .duration_ms = 1000,
-    .uniform_color = {.color = TWILIGHT_NO_CONFIG_COLOR},
-};
+// Number of frames the driver would have pushed since it was suspended.
+uint32_t _suppressed_frames(void) {
+  if (!state_.driver_suspended_at.has_value()) return 0;
+  const uint64_t elapsed_ms = (xTaskGetTickCount() - *state_.driver_suspended_at) *
+                              (uint64_t)portTICK_PERIOD_MS;
+  return elapsed_ms * TWILIGHT_FPS_STEPS[state_.fps_step] / 1000;
+}
 
-esp_err_t _start_lightshow_driver(const LS::IOConfig& io_config, LS::Renderer* renderer) {
+esp_err_t _run_lightshow_driver(const LS::IOConfig& io_config, LS::Renderer* renderer) {
   // Assume holding strip_lock
-  ESP_RETURN_ON_ERROR(
-      renderer->EnqueueOrError(LS::NoopTarget::Create(TWILIGHT_TRANSITION_COOLDOWN_MS)));
   ESP_RETURN_ON_ERROR(LS::DriverSetup(io_config, renderer));
   ESP_RETURN_ON_ERROR(LS::DriverStart(/*task_stack=*/TWILIGHT_LIGHTSHOW_TASK_STACK_SIZE,
                                       /*task_priority=*/TWILIGHT_LIGHTSHOW_TASK_PRIORITY));
+  {
+    ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.stats_lock);
+    state_.stats.suppressed_frames += _suppressed_frames();
+    state_.driver_suspended_at.reset();
+    state_.driver_running = true;
+  }
+  return ESP_OK;
+}
+
+esp_err_t _start_lightshow_driver(const LS::IOConfig& io_config, LS::Renderer* renderer) {
+  // Assume holding strip_lock
+  ESP_RETURN_ON_ERROR(
+      renderer->EnqueueOrError(LS::NoopTarget::Create(TWILIGHT_TRANSITION_COOLDOWN_MS)));
+  return _run_lightshow_driver(io_config, renderer);
+}
+
+esp_err_t _stop_lightshow_driver(void) {
+  // Assume holding strip_lock
+  if (!state_.driver_running) return ESP_OK;
+  ESP_RETURN_ON_ERROR(LS::DriverStop());
+  state_.driver_running = false;
+  return ESP_OK;
+}
+
+// Stop pushing frames to a settled strip.
+esp_err_t _suspend_lightshow_driver(void) {
+  // Assume holding strip_lock, and the renderer is idle
+  if (!state_.driver_running) return ESP_OK;
+  ESP_LOGD(TAG, "Suspending LightShow driver...");
+  ESP_RETURN_ON_ERROR(_stop_lightshow_driver());
+  {
+    ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.stats_lock);
+    state_.driver_suspended_at = xTaskGetTickCount();
+  }
   return ESP_OK;
 }
 
+// Resume pushing frames before enqueuing anything to a suspended renderer.
+esp_err_t _resume_lightshow_driver(void) {
+  // Assume holding strip_lock
+  if (state_.driver_running) return ESP_OK;
+  // The renderer still holds the frame on the strip, so no cooldown is needed.
+  ESP_LOGD(TAG, "Resuming LightShow driver...");
+  return _run_lightshow_driver(state_.io_config, state_.renderer.get());
+}
+
 esp_err_t _setup_effect_pixel_num(LS::Renderer* renderer, size_t num_pixels) {
   ESP_RETURN_ON_ERROR(renderer->EnqueueOrError(LS::WiperTarget::Create(
       TWILIGHT_PIXEL_SETUP_BLADE_WIPE_MS_BASE +
@@ -126,6 +229,109 @@ esp_err_t _setup_effect_pixel_num(LS::Renderer* renderer, size_t num_pixels) {
   return ESP_OK;
 }
 
+esp_err_t _enqueue_keyframe(LS::Renderer* renderer, const Keyframe& keyframe) {
+  switch (keyframe.type) {
+    case Keyframe::Type::NOOP:
+      return renderer->EnqueueOrError(LS::NoopTarget::Create(keyframe.duration_ms));
+
+    case Keyframe::Type::UNIFORM_COLOR:
+      return renderer->EnqueueOrError(
+          LS::UniformColorTarget::Create(keyframe.duration_ms, keyframe.color));
+
+    case Keyframe::Type::COLOR_WIPE:
+      // The wiper takes its blade width as a fraction.
+      return renderer->EnqueueOrError(LS::WiperTarget::Create(
+          keyframe.duration_ms,
+          LS::WiperTarget::ColorWipeConfig(
+              keyframe.blade_width / 1000.0f, keyframe.color,
+              (keyframe.direction == Config::Transition::ColorWipe::Direction::RightToLeft)
+                  ? LS::WiperTarget::Direction::RightToLeft
+                  : LS::WiperTarget::Direction::LeftToRight)));
+  }
+  return ESP_ERR_INVALID_ARG;
+}
+
+template <size_t N>
+void _histogram_add(std::array<uint32_t, N>& histogram, uint32_t value) {
+  const size_t bucket = value ? 32 - __builtin_clz(value) : 0;
+  ++histogram[std::min(bucket, N - 1)];
+}
+
+// Record how much playback time is queued in the renderer.
+void _stats_queue_depth(uint32_t queued_ms) {
+  ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.stats_lock);
+  _histogram_add(state_.stats.queue_depth_ms, queued_ms);
+}
+
+// Cancel transitions staged ahead of an event boundary, in favor of a manual override.
+void _cancel_staged_transitions(void) {
+  ESP_LOGD(TAG, "Staged transitions canceled");
+  xEventGroupClearBits(state_.status, TWILIGHT_STATUS_OVERRIDE);
+  xEventGroupSetBits(state_.status, TWILIGHT_STATUS_INTERRUPT);
+  state_.current_event.event_idx = EVENT_IDX_UNINITIALIZED;
+}
+
+// Feeds keyframes to the renderer, at most `TWILIGHT_RENDER_AHEAD_MS` ahead of the playback,
+// so that long keyframe sequences do not pile up in the renderer queue.
+// Within the first `lead_ms` of the playback, the keyframes are staged, and also canceled
+// by a manual override.
+class KeyframePacer {
+ public:
+  explicit KeyframePacer(LS::Renderer* renderer, uint32_t lead_ms = 0)
+      : renderer_(renderer), start_(xTaskGetTickCount()), lead_ms_(lead_ms) {}
+
+  bool interrupted(void) const { return interrupted_; }
+
+  esp_err_t Feed(const Keyframe& keyframe) {
+    while (true) {
+      // Let the playback catch up; the interrupt is left for the caller to handle.
+      const uint32_t played_ms = (xTaskGetTickCount() - start_) * portTICK_PERIOD_MS;
+      const bool staged = played_ms < lead_ms_;
+      const uint32_t ahead_ms = (queued_ms_ > played_ms + TWILIGHT_RENDER_AHEAD_MS)
+                                    ? queued_ms_ - played_ms - TWILIGHT_RENDER_AHEAD_MS
+                                    : 0;
+      const uint32_t wait_ms = staged ? std::min(ahead_ms, lead_ms_ - played_ms) : ahead_ms;
+      const EventBits_t bits = xEventGroupWaitBits(
+          state_.status, TWILIGHT_STATUS_INTERRUPT | (staged ? TWILIGHT_STATUS_OVERRIDE : 0),
+          false, false, (wait_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+      if (staged && (bits & TWILIGHT_STATUS_OVERRIDE)) _cancel_staged_transitions();
+      if (xEventGroupGetBits(state_.status) & TWILIGHT_STATUS_INTERRUPT) {
+        interrupted_ = true;
+        return ESP_ERR_INVALID_STATE;
+      }
+      if (ahead_ms == 0) break;
+    }
+    ESP_RETURN_ON_ERROR(_enqueue_keyframe(renderer_, keyframe));
+    queued_ms_ += keyframe.duration_ms;
+    _stats_queue_depth(queued_ms_ - std::min(queued_ms_, played_ms));
+    return ESP_OK;
+  }
+
+ private:
+  LS::Renderer* renderer_;
+  TickType_t start_;
+  uint32_t lead_ms_;
+  uint32_t queued_ms_ = 0;
+  bool interrupted_ = false;
+};
+
+esp_err_t _render_transition(KeyframePacer& pacer, const Config::Transition& transition) {
+  esp_err_t err = PlanTransition(
+      transition, [&pacer](const Keyframe& keyframe) { return pacer.Feed(keyframe); });
+  if (err == ESP_OK || pacer.interrupted()) return ESP_OK;
+  // A broken show file should not take down the service.
+  if (transition.type == Config::Transition::Type::KEYFRAME_SHOW) {
+    ESP_LOGW(TAG, "Show '%s' aborted", transition.keyframe_show.file);
+    return ESP_OK;
+  }
+  return err;
+}
+
+esp_err_t _render_transition(LS::Renderer* renderer, const Config::Transition& transition) {
+  KeyframePacer pacer(renderer);
+  return _render_transition(pacer, transition);
+}
+
 esp_err_t _setup_effect_transition(LS::Renderer* renderer, const Config::Transition& transition) {
   switch (transition.type) {
     case Config::Transition::Type::UNIFORM_COLOR: {
@@ -150,34 +356,34 @@ esp_err_t _setup_effect_transition(LS::Renderer* renderer, const Config::Transit
           renderer->EnqueueOrError(LS::NoopTarget::Create(TWILIGHT_TRANSITION_COOLDOWN_MS)));
     } break;
 
-    case Config::Transition::Type::COLOR_WIPE: {
-      ESP_LOGW(TAG, "Unimplemented");
-    } break;
-
+    case Config::Transition::Type::COLOR_WIPE:
     case Config::Transition::Type::COLOR_WHEEL: {
-      ESP_LOGW(TAG, "Unimplemented");
-    } break;
-
-    default:
-      ESP_LOGW(TAG, "Unrecognized transition type");
-  }
-
-  return ESP_OK;
-}
-
-esp_err_t _render_transition(LS::Renderer* renderer, const Config::Transition& transition) {
-  switch (transition.type) {
-    case Config::Transition::Type::UNIFORM_COLOR: {
+      // Show the transition from both a dark and a lit strip
+      ESP_RETURN_ON_ERROR(
+          renderer->EnqueueOrError(LS::UniformColorTarget::Create(100, LS::RGB8BPixel::BLACK())));
+      ESP_RETURN_ON_ERROR(
+          renderer->EnqueueOrError(LS::NoopTarget::Create(TWILIGHT_TRANSITION_COOLDOWN_MS)));
+      ESP_RETURN_ON_ERROR(_render_transition(renderer, transition));
+      ESP_RETURN_ON_ERROR(
+          renderer->EnqueueOrError(LS::NoopTarget::Create(TWILIGHT_TRANSITION_COOLDOWN_MS)));
       ESP_RETURN_ON_ERROR(renderer->EnqueueOrError(
-          LS::UniformColorTarget::Create(transition.duration_ms, transition.uniform_color.color)));
-    } break;
-
-    case Config::Transition::Type::COLOR_WIPE: {
-      ESP_LOGW(TAG, "Unimplemented");
+          LS::UniformColorTarget::Create(100, TWILIGHT_TRANSITION_SETUP_ON_COLOR)));
+      ESP_RETURN_ON_ERROR(
+          renderer->EnqueueOrError(LS::NoopTarget::Create(TWILIGHT_TRANSITION_COOLDOWN_MS)));
+      ESP_RETURN_ON_ERROR(_render_transition(renderer, transition));
+      ESP_RETURN_ON_ERROR(
+          renderer->EnqueueOrError(LS::NoopTarget::Create(TWILIGHT_TRANSITION_COOLDOWN_MS)));
     } break;
 
-    case Config::Transition::Type::COLOR_WHEEL: {
-      ESP_LOGW(TAG, "Unimplemented");
+    case Config::Transition::Type::KEYFRAME_SHOW: {
+      // Shows set their own colors, so play once from a dark strip, streamed as for events.
+      ESP_RETURN_ON_ERROR(
+          renderer->EnqueueOrError(LS::UniformColorTarget::Create(100, LS::RGB8BPixel::BLACK())));
+      ESP_RETURN_ON_ERROR(
+          renderer->EnqueueOrError(LS::NoopTarget::Create(TWILIGHT_TRANSITION_COOLDOWN_MS)));
+      ESP_RETURN_ON_ERROR(_render_transition(renderer, transition));
+      ESP_RETURN_ON_ERROR(
+          renderer->EnqueueOrError(LS::NoopTarget::Create(TWILIGHT_TRANSITION_COOLDOWN_MS)));
     } break;
 
     default:
@@ -188,46 +394,39 @@ esp_err_t _render_transition(LS::Renderer* renderer, const Config::Transition& t
 }
 
 esp_err_t _render_transitions(LS::Renderer* renderer,
-                              const std::vector<const Config::Transition*>& transitions) {
+                              const std::vector<const Config::Transition*>& transitions,
+                              uint32_t lead_ms) {
+  KeyframePacer pacer(renderer, lead_ms);
+  if (lead_ms > 0) {
+    ESP_RETURN_ON_ERROR(pacer.Feed({.type = Keyframe::Type::NOOP, .duration_ms = lead_ms}));
+  }
   for (const Config::Transition* transition : transitions) {
-    ESP_RETURN_ON_ERROR(_render_transition(renderer, *transition));
+    ESP_RETURN_ON_ERROR(_render_transition(pacer, *transition));
+    if (pacer.interrupted()) break;
   }
   return ESP_OK;
 }
 
-utils::DataOrError<std::deque<EventEntry>> _recompute_event_sequence(const struct tm& time_tm) {
-  int32_t second_of_day = get_second_of_day(time_tm);
-
-  std::vector<RawEventEntry> raw_events = generate_raw_events(config_.events, time_tm);
+EventEntry _overlay_manual_override(const TimelineEntry& entry, int64_t local_seconds) {
+  EventEntry result = {.completion = entry.completion, .event_idx = entry.event_idx};
   if (state_.manual_override.has_value()) {
-    const auto& [start_time, duration] = *state_.manual_override;
-    int32_t end_time = (duration > 0) ? (start_time + duration) : -1;
-    if (end_time > SECONDS_IN_A_DAY) {
-      // Split the duration across mid-night
-      state_.manual_override = std::make_pair(0, end_time - SECONDS_IN_A_DAY);
-      end_time = SECONDS_IN_A_DAY;
-    } else {
+    const auto& [start_time, end_time] = *state_.manual_override;
+    // Override without specific end-time ends when the next scheduled event starts
+    if ((end_time >= 0) ? (local_seconds >= end_time) : (entry.last_start > start_time)) {
       state_.manual_override.reset();
+    } else {
+      result.event_idx = EVENT_IDX_MANUAL_OVERRIDE;
+      if (end_time >= 0) result.completion = std::min(result.completion, end_time);
     }
-    raw_events.push_back({
-        .start = start_time,
-        .end = end_time,
-        .event_idx = EVENT_IDX_MANUAL_OVERRIDE,
-    });
   }
-  return convert_raw_events(std::move(raw_events), second_of_day);
+  return result;
 }
 
-void _insert_config_transitions(const Config::Event& event) {
-  for (const std::string& transition_name : event.transitions) {
-    auto iter = config_.transitions.find(transition_name);
-    if (iter != config_.transitions.end()) {
-      state_.transitions.push_back(&iter->second);
-    } else {
-      ESP_LOGW(TAG, "Unknown transition '%s'", transition_name.c_str());
-      state_.transitions.push_back(&TWILIGHT_NO_CONFIG_TRANSITION);
-    }
-  }
+void _insert_config_transitions(int16_t event_idx) {
+  const EventTransitions& resolved = state_.event_transitions;
+  auto iter = resolved.transitions.begin();
+  state_.transitions.insert(state_.transitions.end(), iter + resolved.start[event_idx],
+                            iter + resolved.start[event_idx + 1]);
 }
 
 void _insert_non_config_transitions(int16_t event_idx) {
@@ -246,71 +445,322 @@ void _insert_non_config_transitions(int16_t event_idx) {
   }
 }
 
-esp_err_t _check_events() {
+esp_err_t _check_events(TickType_t& idle_ticks) {
   if (eventmgr::system_states_peek(ZW_SYSTEM_STATE_TIME_NTP_TRACKING |
                                    ZW_SYSTEM_STATE_TIME_ALIGNED) !=
       (ZW_SYSTEM_STATE_TIME_NTP_TRACKING | ZW_SYSTEM_STATE_TIME_ALIGNED)) {
     // Do not act based on time if it is unanchored.
+    idle_ticks = TWILIGHT_TASK_UNANCHORED_IDLE;
     return ESP_OK;
   }
-  ASSIGN_OR_RETURN(struct tm time_tm, time::GetLocalTime());
-  int32_t second_of_day = get_second_of_day(time_tm);
-
-  bool new_transitions = state_.event_sequence.empty();
-  int16_t last_event_idx = EVENT_IDX_UNINITIALIZED;
-  // Regular serving will enter this loop when the current event has completed.
-  // But if we come from exiting setup, the event_sequence is already cleared.
-  while (!state_.event_sequence.empty()) {
-    const EventEntry& entry = state_.event_sequence.front();
-    if (entry.completion < second_of_day ||
-        (second_of_day == 0 && entry.completion == SECONDS_IN_A_DAY)) {
-      if (last_event_idx == EVENT_IDX_UNINITIALIZED) last_event_idx = entry.event_idx;
-      state_.event_sequence.pop_front();
-      new_transitions = true;
-      continue;
-    }
-    break;
+  struct timeval tv;
+  if (gettimeofday(&tv, NULL) != 0) {
+    ESP_LOGW(TAG, "Unable to get current time");
+    return ESP_FAIL;
   }
-  if (state_.event_sequence.empty()) {
-    ASSIGN_OR_RETURN(state_.event_sequence, _recompute_event_sequence(time_tm));
+  ASSIGN_OR_RETURN(struct tm time_tm, time::ToLocalTime(tv.tv_sec));
+  int64_t local_seconds = get_local_seconds(time_tm);
+
+  // Regular serving only looks up the timeline when the current event has completed,
+  // or the time has been re-based. But if we come from exiting setup or an override,
+  // the current event is uninitialized.
+  const int16_t last_event_idx = state_.current_event.event_idx;
+  const bool time_rebase = xEventGroupClearBits(state_.status, TWILIGHT_STATUS_TIME_REBASE) &
+                           TWILIGHT_STATUS_TIME_REBASE;
+  // Shortly before the current event completes, look up the event following it instead,
+  // and stage its transitions to start right at the boundary.
+  // The completion of an uninitialized event is meaningless, and may be far in the past.
+  int32_t lead_ms = 0;
+  if (last_event_idx != EVENT_IDX_UNINITIALIZED && !time_rebase &&
+      state_.current_event.completion > local_seconds) {
+    const int32_t lead_sec = std::min<int64_t>(state_.current_event.completion - local_seconds,
+                                               TWILIGHT_TASK_MAX_IDLE_SEC);
+    lead_ms = lead_sec * 1000 - tv.tv_usec / 1000;
   }
+  const bool look_ahead = lead_ms > 0 && lead_ms <= TWILIGHT_EVENT_LOOKAHEAD_MS;
+  if (last_event_idx == EVENT_IDX_UNINITIALIZED || time_rebase || look_ahead ||
+      local_seconds >= state_.current_event.completion) {
+    int64_t lookup_seconds = local_seconds;
+    if (look_ahead) {
+      lookup_seconds = state_.current_event.completion;
+      ASSIGN_OR_RETURN(time_tm, time::ToLocalTime(tv.tv_sec + lookup_seconds - local_seconds));
+    }
+    TimelineEntry entry;
+    {
+      ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.timeline_lock);
+      ASSIGN_OR_RETURN(entry, state_.timeline.Lookup(time_tm));
+    }
+    state_.current_event = _overlay_manual_override(entry, lookup_seconds);
+    state_.transitions_lead_ms = look_ahead ? lead_ms : 0;
 
-  if (new_transitions) {
-    const int16_t event_idx = state_.event_sequence.front().event_idx;
-    // In regular serving, it is possible that a scheduled event is split into
-    // multiple windows. If we are roaming across windows of the same event,
-    // there is no need to re-run its transitions.
+    const int16_t event_idx = state_.current_event.event_idx;
+    // It is possible that an effective event spans multiple timeline segments.
+    // If we are roaming across segments of the same event, there is no need to
+    // re-run its transitions.
     if (event_idx != last_event_idx) {
+      ESP_LOGI(TAG, "Event %d --> %d", last_event_idx, event_idx);
       if (event_idx < 0) {
         // For non-configured event, the index denotes the type
         _insert_non_config_transitions(event_idx);
       } else {
         // Run event transitions according to its configuration.
-        _insert_config_transitions(config_.events[event_idx]);
+        _insert_config_transitions(event_idx);
       }
     }
   }
+
+  // Sleep until the look-ahead of the current event completion (rounded up to the next tick).
+  int32_t idle_sec = std::min<int64_t>(state_.current_event.completion - local_seconds,
+                                       TWILIGHT_TASK_MAX_IDLE_SEC);
+  int32_t idle_ms = idle_sec * 1000 - tv.tv_usec / 1000;
+  if (idle_sec < TWILIGHT_TASK_MAX_IDLE_SEC) idle_ms -= TWILIGHT_EVENT_LOOKAHEAD_MS;
+  idle_ticks = (std::max<int32_t>(idle_ms, 0) * CONFIG_FREERTOS_HZ + 999) / 1000;
   return ESP_OK;
 }
 
+uint32_t _smooth_fps(uint32_t color_delta, uint32_t duration_ms) {
+  if (duration_ms == 0) return TWILIGHT_TARGET_FPS;
+  return (color_delta * 1000 / TWILIGHT_FPS_SMOOTH_COLOR_STEP + duration_ms - 1) / duration_ms;
+}
+
+// The frame rate a transition needs to render smoothly. Also tracks `color`, the uniform
+// color it leaves the strip in, if known.
+uint32_t _transition_fps(const Config::Transition& transition, std::optional<LS::RGB888>& color) {
+  switch (transition.type) {
+    case Config::Transition::Type::UNIFORM_COLOR: {
+      const LS::RGB888& target = transition.uniform_color.color;
+      auto channel_delta = [](uint8_t from, uint8_t to) {
+        return (uint32_t)(from > to ? from - to : to - from);
+      };
+      const uint32_t color_delta =
+          color.has_value() ? std::max({channel_delta(color->r, target.r),
+                                        channel_delta(color->g, target.g),
+                                        channel_delta(color->b, target.b)})
+                            : 0xFF;
+      color = target;
+      return _smooth_fps(color_delta, transition.duration_ms);
+    }
+
+    case Config::Transition::Type::COLOR_WHEEL: {
+      // Each sector of the wheel sweeps one channel through the full intensity.
+      const auto& params = transition.color_wheel;
+      const uint32_t total_degrees = color_wheel_degrees(params) + WHEEL_SECTOR_DEGREES;
+      color = color_wheel_end(params);
+      return _smooth_fps(color_wheel_value(params), (uint64_t)transition.duration_ms *
+                                                        WHEEL_SECTOR_DEGREES / total_degrees);
+    }
+
+    default:
+      color.reset();
+      return TWILIGHT_TARGET_FPS;
+  }
+}
+
+size_t _batch_fps_step(const std::vector<const Config::Transition*>& transitions,
+                       std::optional<LS::RGB888>& color) {
+  uint32_t fps = 0;
+  for (const Config::Transition* transition : transitions) {
+    fps = std::max(fps, _transition_fps(*transition, color));
+  }
+  size_t fps_step = 0;
+  while (fps_step < TWILIGHT_FPS_STEP_TARGET && TWILIGHT_FPS_STEPS[fps_step] < fps) ++fps_step;
+  return std::min(fps_step, state_.fps_step_ceiling);
+}
+
+esp_err_t _create_renderer(size_t num_pixels, size_t fps_step) {
+  ASSIGN_OR_RETURN(state_.renderer,
+                   LS::Renderer::Create(num_pixels, TWILIGHT_FPS_STEPS[fps_step],
+                                        TWILIGHT_RENDERER_BLEND_MODE));
+  state_.renderer_pixels = num_pixels;
+  state_.fps_step = fps_step;
+  return ESP_OK;
+}
+
+// Replaces the renderer. The old one is released first, so that its frame buffers can be
+// reused by the new one, instead of fragmenting the heap.
+// If the new renderer cannot be created, the old one is recreated and an error returned;
+// only if that also fails, the renderer is left null, and the system marked failed.
+esp_err_t _replace_renderer(size_t num_pixels, size_t fps_step) {
+  // Assume holding strip_lock, and the renderer is idle.
+  ESP_RETURN_ON_ERROR(_stop_lightshow_driver());
+  state_.renderer.reset();
+  esp_err_t err = _create_renderer(num_pixels, fps_step);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Unable to create renderer (%d pixels, %d fps), restoring...", num_pixels,
+             TWILIGHT_FPS_STEPS[fps_step]);
+    if (_create_renderer(state_.renderer_pixels, state_.fps_step) != ESP_OK) {
+      ESP_LOGE(TAG, "Unable to restore renderer!");
+      eventmgr::SetSystemFailed();
+    }
+  }
+  return err;
+}
+
+esp_err_t _switch_renderer_fps(size_t fps_step) {
+  // Assume holding strip_lock, and the renderer is idle.
+  if (fps_step == state_.fps_step) return ESP_OK;
+
+  esp_err_t err = _replace_renderer(state_.renderer_pixels, fps_step);
+  if (!state_.renderer) return err;
+  if (state_.strip_color.has_value()) {
+    // Pick up from what the strip is showing, so the switch is seamless.
+    ESP_RETURN_ON_ERROR(state_.renderer->EnqueueOrError(
+        LS::UniformColorTarget::Create(0, *state_.strip_color)));
+  }
+  // The driver was pushing frames just now, no cooldown is needed. This also keeps staged
+  // transitions on time.
+  ESP_RETURN_ON_ERROR(_run_lightshow_driver(state_.io_config, state_.renderer.get()));
+
+  // Failing to switch is not fatal, the renderer keeps running at the previous rate.
+  if (err == ESP_OK) ESP_LOGI(TAG, "Renderer frame rate -> %d", TWILIGHT_FPS_STEPS[fps_step]);
+  return ESP_OK;
+}
+
+// Switch the renderer frame rate for a batch.
+// A switch is not free: the renderer is released and created anew, which frees and
+// reallocates its frame buffers on the heap, and the driver is stopped and restarted.
+// Hence lowering the rate only to save work takes hysteresis, and a known strip color to
+// switch seamlessly. Raising it, or backing off while the driver cannot keep up, is always
+// done, as the batch would not render smoothly otherwise; with the strip color unknown,
+// the new renderer blends in from black.
+esp_err_t _adapt_renderer_fps(size_t fps_step) {
+  // Assume holding strip_lock, and the renderer is idle.
+  if (fps_step == state_.fps_step) {
+    state_.fps_lower_batches = 0;
+    return ESP_OK;
+  }
+  if (fps_step < state_.fps_step && state_.fps_step <= state_.fps_step_ceiling) {
+    state_.fps_lower_step =
+        state_.fps_lower_batches++ ? std::max(state_.fps_lower_step, fps_step) : fps_step;
+    if (state_.fps_lower_batches < TWILIGHT_FPS_LOWER_BATCHES) return ESP_OK;
+    if (!state_.strip_color.has_value()) return ESP_OK;
+    fps_step = state_.fps_lower_step;
+  }
+
+  state_.fps_lower_batches = 0;
+  return _switch_renderer_fps(fps_step);
+}
+
+// Back off the frame rate when the driver struggles to keep up, and recover gradually.
+void _adapt_fps_ceiling(const LS::IOStats& io_stats) {
+  if (io_stats.underflow_actual > 0 || io_stats.underflow_near_miss > 0) {
+    if (state_.fps_step_ceiling > 0) {
+      --state_.fps_step_ceiling;
+      ESP_LOGW(TAG, "Frame rate capped at %d", TWILIGHT_FPS_STEPS[state_.fps_step_ceiling]);
+    }
+  } else if (state_.fps_step_ceiling < TWILIGHT_FPS_STEP_TARGET) {
+    ++state_.fps_step_ceiling;
+  }
+}
+
+// A batch of transitions being rendered, for telemetry.
+struct TransitionBatch {
+  uint32_t types;  // Bit-indexed by transition type
+  uint32_t lead_ms;  // Included in `scheduled_ms`
+  uint32_t scheduled_ms;
+  TickType_t start;
+  uint32_t wait_wakeups;  // Times the service task woke up while waiting for the batch
+};
+
+TransitionBatch _stats_batch_start(const std::vector<const Config::Transition*>& transitions,
+                                   uint32_t lead_ms) {
+  TransitionBatch batch = {.types = 0,
+                           .lead_ms = lead_ms,
+                           .scheduled_ms = lead_ms,
+                           .start = xTaskGetTickCount(),
+                           .wait_wakeups = 0};
+  for (const Config::Transition* transition : transitions) {
+    batch.types |= 1 << static_cast<size_t>(transition->type);
+    batch.scheduled_ms += transition->duration_ms;
+  }
+
+  ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.stats_lock);
+  _histogram_add(state_.stats.batch_transitions, transitions.size());
+  return batch;
+}
+
+void _stats_batch_end(const TransitionBatch& batch, const LS::IOStats& io_stats) {
+  const uint32_t elapsed_ms = (xTaskGetTickCount() - batch.start) * portTICK_PERIOD_MS;
+
+  ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.stats_lock);
+  if (batch.types != 0) {
+    const bool single_type = (batch.types & (batch.types - 1)) == 0;
+    auto& transition_stats = single_type ? state_.stats.transitions[__builtin_ctz(batch.types)]
+                                         : state_.stats.mixed_transitions;
+    ++transition_stats.batches;
+    transition_stats.underflows += io_stats.underflow_actual;
+    transition_stats.near_misses += io_stats.underflow_near_miss;
+  }
+  _histogram_add(state_.stats.batch_overrun_ms,
+                 elapsed_ms > batch.scheduled_ms ? elapsed_ms - batch.scheduled_ms : 0);
+  _histogram_add(state_.stats.batch_wait_wakeups, batch.wait_wakeups);
+#if ISR_DEVELOPMENT
+  const uint32_t latency_low_us = io_stats.isr_process_latency_low / g_esp_ticks_per_us;
+  const uint32_t latency_high_us = io_stats.isr_process_latency_high / g_esp_ticks_per_us;
+  state_.stats.isr_latency_low_us = state_.stats.has_isr_stats
+                                        ? std::min(state_.stats.isr_latency_low_us, latency_low_us)
+                                        : latency_low_us;
+  state_.stats.isr_latency_high_us = std::max(state_.stats.isr_latency_high_us, latency_high_us);
+  _histogram_add(state_.stats.isr_latency_us, latency_high_us);
+  state_.stats.isr_late_wakeups += io_stats.isr_late_wakeup;
+  state_.stats.has_isr_stats = true;
+#endif
+}
+
+void _count_wakeup() {
+  ++state_.wakeup_count;
+  TickType_t now = xTaskGetTickCount();
+  if (now - state_.wakeup_count_since >= TWILIGHT_TASK_WAKEUP_REPORT) {
+    state_.wakeups_per_hour = state_.wakeup_count;
+    ESP_LOGI(TAG, "Service task woke up %d times in the last hour", state_.wakeups_per_hour);
+    state_.wakeup_count = 0;
+    state_.wakeup_count_since = now;
+  }
+}
+
 void _twilight_task(TimerHandle_t) {
+  state_.wakeup_count_since = xTaskGetTickCount();
   while (true) {
+    _count_wakeup();
+    // Without anything pending, sleep until notified.
+    TickType_t idle_ticks = portMAX_DELAY;
+
     std::optional<Config> config_setup;
+    TickType_t live_ticks = 0;
+    bool live_stopped = false;
     {
       ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.state_lock);
       config_setup = state_.config_setup;
-      xEventGroupClearBits(state_.status, TWILIGHT_STATUS_INTERRUPT);
+      xEventGroupClearBits(state_.status, TWILIGHT_STATUS_INTERRUPT | TWILIGHT_STATUS_OVERRIDE);
+      if (state_.live_until.has_value()) {
+        live_ticks = *state_.live_until - xTaskGetTickCount();
+        if (config_setup.has_value() || (int32_t)live_ticks <= 0) {
+          ESP_LOGI(TAG, "Live stream stopped");
+          state_.live_until.reset();
+          state_.current_event.event_idx = EVENT_IDX_UNINITIALIZED;
+          live_ticks = 0;
+          live_stopped = true;
+        }
+      }
     }
 
     {
       ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.strip_lock);
       if (eventmgr::IsSystemFailed()) break;
       bool lightshow_action = false;
+      std::optional<TransitionBatch> batch;
 
       LS::Renderer* renderer = state_.renderer.get();
       EventBits_t cur_status = xEventGroupGetBits(state_.status);
       if (config_setup.has_value()) {
-        // We are in set up mode
+        // We are in set up mode, which always shows at the target frame rate.
+        // The setup effects redraw the whole strip, so the switch needs not be seamless.
+        if (cur_status & TWILIGHT_STATUS_SETUP_MASK) {
+          ESP_GOTO_ON_ERROR(_switch_renderer_fps(TWILIGHT_FPS_STEP_TARGET), failure);
+          ESP_GOTO_ON_ERROR(_resume_lightshow_driver(), failure);
+          renderer = state_.renderer.get();
+          state_.strip_color.reset();
+        }
         if (cur_status & TWILIGHT_STATUS_SETUP_PIXELS) {
           ESP_GOTO_ON_ERROR(_setup_effect_pixel_num(renderer, state_.config_setup->num_pixels),
                             failure);
@@ -322,29 +772,74 @@ void _twilight_task(TimerHandle_t) {
             xEventGroupClearBits(state_.status, TWILIGHT_STATUS_SETUP_TRANSITION);
         }
         // Since setup will likely change the active events and/or presentation of a transition
-        // We'd better invalidate previously computed event sequence -- after exiting the setup,
-        // the event sequence will be re-computed and the transitions will also be re-rendered.
-        state_.event_sequence.clear();
+        // We'd better invalidate the current event -- after exiting the setup, the effective
+        // event will be looked up again and the transitions will also be re-rendered.
+        state_.current_event.event_idx = EVENT_IDX_UNINITIALIZED;
         // Setup will terminate any on-going manual override.
         state_.manual_override.reset();
+      } else if (live_ticks > 0) {
+        // A live stream is playing, leave the strip to it until it goes quiet.
+        idle_ticks = live_ticks;
       } else {
         // In regular service mode
-        ESP_GOTO_ON_ERROR(_check_events(), failure);
+        if (live_stopped && renderer != nullptr) {
+          // Let the last live keyframes play out, before the events may switch the frame rate.
+          const TickType_t queue_ticks = TWILIGHT_RENDER_AHEAD_MS / portTICK_PERIOD_MS;
+          renderer->WaitFor(LS::RENDERER_IDLE_TARGET, queue_ticks + TWILIGHT_TASK_RENDER_POLL);
+        }
+        ESP_GOTO_ON_ERROR(_check_events(idle_ticks), failure);
         if (!state_.transitions.empty()) {
-          ESP_GOTO_ON_ERROR(_render_transitions(renderer, state_.transitions), failure);
+          std::optional<LS::RGB888> end_color = state_.strip_color;
+          ESP_GOTO_ON_ERROR(
+              _adapt_renderer_fps(_batch_fps_step(state_.transitions, end_color)), failure);
+          ESP_GOTO_ON_ERROR(_resume_lightshow_driver(), failure);
+          renderer = state_.renderer.get();
+
+          batch = _stats_batch_start(state_.transitions, state_.transitions_lead_ms);
+          ESP_GOTO_ON_ERROR(
+              _render_transitions(renderer, state_.transitions, state_.transitions_lead_ms),
+              failure);
           state_.transitions.clear();
+          state_.strip_color = end_color;
           lightshow_action = true;
         }
       }
 
       if (lightshow_action) {
-        // Wait for transition to finish before releasing strip lock
-        while (state_.renderer->WaitFor(LS::RENDERER_IDLE_TARGET, 1) == 0) {
-          if (xEventGroupWaitBits(state_.status, TWILIGHT_STATUS_INTERRUPT, true, false, 0) &
+        // Wait for transition to finish before releasing strip lock.
+        // The renderer cannot signal our event group, so first block on interrupts alone
+        // until the scheduled end of the batch, then poll the renderer for the overrun.
+        TickType_t interrupt_wait = 0;
+        if (batch.has_value()) {
+          // Until they start, staged transitions are also canceled by an override.
+          const TickType_t lead = batch->lead_ms / portTICK_PERIOD_MS;
+          TickType_t elapsed = xTaskGetTickCount() - batch->start;
+          // The keyframe feed checks for an override as it goes, this covers the rest.
+          if (elapsed < lead &&
+              (xEventGroupWaitBits(state_.status,
+                                   TWILIGHT_STATUS_OVERRIDE | TWILIGHT_STATUS_INTERRUPT, false,
+                                   false, lead - elapsed) &
+               TWILIGHT_STATUS_OVERRIDE)) {
+            _cancel_staged_transitions();
+          }
+
+          const TickType_t scheduled = batch->scheduled_ms / portTICK_PERIOD_MS;
+          elapsed = xTaskGetTickCount() - batch->start;
+          if (elapsed < scheduled) interrupt_wait = scheduled - elapsed;
+        }
+        for (uint32_t wait_wakeups = 1;; ++wait_wakeups) {
+          if (xEventGroupWaitBits(state_.status, TWILIGHT_STATUS_INTERRUPT, true, false,
+                                  interrupt_wait) &
               TWILIGHT_STATUS_INTERRUPT) {
             // If interrupt is requested, abort the ongoing transition.
             state_.renderer->Clear(true);
+            state_.strip_color.reset();
           }
+          if (state_.renderer->WaitFor(LS::RENDERER_IDLE_TARGET, TWILIGHT_TASK_RENDER_POLL) != 0) {
+            if (batch.has_value()) batch->wait_wakeups = wait_wakeups;
+            break;
+          }
+          interrupt_wait = 0;
         }
 
         LS::IOStats io_stats = LS::DriverStats();
@@ -355,11 +850,19 @@ void _twilight_task(TimerHandle_t) {
                  io_stats.isr_process_latency_low / g_esp_ticks_per_us,
                  io_stats.isr_process_latency_high / g_esp_ticks_per_us, io_stats.isr_late_wakeup);
 #endif
+        if (batch.has_value()) {
+          _stats_batch_end(*batch, io_stats);
+          _adapt_fps_ceiling(io_stats);
+        }
         continue;
       }
-      // Nothing to do, just sleep for a bit.
-      vTaskDelay(TWILIGHT_TASK_IDLE);
+
+      // The strip has settled, stop pushing identical frames until the next action.
+      if (live_ticks == 0) ESP_GOTO_ON_ERROR(_suspend_lightshow_driver(), failure);
     }
+
+    // Nothing to do, sleep until the next deadline or notification.
+    xEventGroupWaitBits(state_.status, TWILIGHT_STATUS_WAKEUP, true, false, idle_ticks);
   }
 
 failure:
@@ -374,6 +877,16 @@ void _twilight_task_event(int32_t event_id, void*, void*) {
       ESP_LOGD(TAG, "Starting LightShow driver...");
       ESP_GOTO_ON_ERROR(_start_lightshow_driver(state_.io_config, state_.renderer.get()), failure);
 
+      // The socket outlives reconnects, so the live stream task is only started once.
+      if (state_.live_task_handle_ == NULL) {
+        ESP_LOGD(TAG, "Starting live stream task...");
+        ESP_GOTO_ON_ERROR(xTaskCreate(ZWTaskWrapper<TAG, live_stream_task>, "twilight_live",
+                                      2000, NULL, 5, &state_.live_task_handle_) == pdPASS
+                              ? ESP_OK
+                              : ESP_FAIL,
+                          failure);
+      }
+
       ESP_LOGD(TAG, "Starting service task...");
       ESP_GOTO_ON_ERROR(xTaskCreate(ZWTaskWrapper<TAG, _twilight_task>, "twilight_serivce", 3000,
                                     NULL, 5, &state_.service_task_handle_) == pdPASS
@@ -387,6 +900,11 @@ void _twilight_task_event(int32_t event_id, void*, void*) {
       }
       break;
 
+    case ZW_SYSTEM_EVENT_TIME_NTP_TRACKING:
+      // Time may have jumped, re-evaluate the effective event.
+      xEventGroupSetBits(state_.status, TWILIGHT_STATUS_TIME_REBASE | TWILIGHT_STATUS_WAKEUP);
+      break;
+
     default:
       ESP_LOGW(TAG, "Unrecognized event %d", event_id);
   }
@@ -401,17 +919,21 @@ esp_err_t _reconfigure_lightshow(const Config& config) {
   ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.strip_lock);
 
   // Turn off all currently configured pixels.
+  ESP_RETURN_ON_ERROR(_resume_lightshow_driver());
   ESP_RETURN_ON_ERROR(
       state_.renderer->EnqueueOrError(LS::UniformColorTarget::Create(0, LS::RGB8BPixel::BLACK())));
   state_.renderer->WaitFor(LS::RENDERER_IDLE_TARGET, portMAX_DELAY);
 
-  ESP_RETURN_ON_ERROR(LS::DriverStop());
-  ASSIGN_OR_RETURN(auto new_renderer, LS::Renderer::Create(config.num_pixels, TWILIGHT_TARGET_FPS,
-                                                           TWILIGHT_RENDERER_BLEND_MODE));
-  ESP_RETURN_ON_ERROR(_start_lightshow_driver(state_.io_config, new_renderer.get()));
-  state_.renderer = std::move(new_renderer);
+  state_.strip_color.reset();
+  if (config.num_pixels == state_.renderer_pixels) return ESP_OK;
 
-  return ESP_OK;
+  // The LightShow renderer is sized on creation, so a resize takes a new one.
+  esp_err_t err = _replace_renderer(config.num_pixels, TWILIGHT_FPS_STEP_TARGET);
+  if (!state_.renderer) return err;
+  // The driver was pushing frames just now, and the strip is blank; no cooldown is needed.
+  ESP_RETURN_ON_ERROR(_run_lightshow_driver(state_.io_config, state_.renderer.get()));
+
+  return err;
 }
 
 esp_err_t _init_twilight(void) {
@@ -433,12 +955,29 @@ esp_err_t _init_twilight(void) {
     return ESP_ERR_NO_MEM;
   }
 
+  state_.stats_lock = xSemaphoreCreateMutex();
+  if (state_.stats_lock == NULL) {
+    ESP_LOGE(TAG, "Failed to create stats access lock!");
+    return ESP_ERR_NO_MEM;
+  }
+
+  state_.timeline_lock = xSemaphoreCreateMutex();
+  if (state_.timeline_lock == NULL) {
+    ESP_LOGE(TAG, "Failed to create timeline access lock!");
+    return ESP_ERR_NO_MEM;
+  }
+
   config_ = config::get()->twilight;
+  ResolveEventTransitions(config_, state_.event_transitions);
+  ESP_RETURN_ON_ERROR(state_.timeline.Compile(config_.events));
+  state_.current_event.event_idx = EVENT_IDX_UNINITIALIZED;
 
   ESP_LOGD(TAG, "Setting up LightShow...");
+  state_.renderer_pixels = config_ ? config_.num_pixels : TWILIGHT_DEFAULT_PIXELS;
   ASSIGN_OR_RETURN(state_.renderer,
-                   LS::Renderer::Create(config_ ? config_.num_pixels : TWILIGHT_DEFAULT_PIXELS,
-                                        TWILIGHT_TARGET_FPS, TWILIGHT_RENDERER_BLEND_MODE));
+                   LS::Renderer::Create(state_.renderer_pixels, TWILIGHT_TARGET_FPS,
+                                        TWILIGHT_RENDERER_BLEND_MODE));
+  state_.fps_step = state_.fps_step_ceiling = TWILIGHT_FPS_STEP_TARGET;
 
   // TODO: Expose IOConfig fields as config entries.
   state_.io_config = LS::CONFIG_WS2812_NEW(TWILIGHT_LIGHTSHOW_JITTER_BUFFER_US);
@@ -446,6 +985,9 @@ esp_err_t _init_twilight(void) {
   // Add HTTPD handler registrar
   httpd::add_ext_handler_registrar(register_httpd_handler);
 
+  ESP_RETURN_ON_ERROR(eventmgr::system_event_register_handler(
+      ZW_SYSTEM_EVENT_TIME_NTP_TRACKING,
+      eventmgr::SystemEventHandlerWrapper<TAG, _twilight_task_event>));
   // Wait for Appliance enter regular serving
   return eventmgr::system_event_register_handler(
       ZW_SYSTEM_EVENT_NET_STA_IP_READY,
@@ -456,6 +998,32 @@ Config& _get_config(AppConfig& config) { return config.twilight; }
 
 }  // namespace
 
+const Config::Transition TWILIGHT_NO_CONFIG_TRANSITION = {
+    .type = Config::Transition::Type::UNIFORM_COLOR,
+    .duration_ms = 1000,
+    .uniform_color = {.color = TWILIGHT_NO_CONFIG_COLOR},
+};
+
+void ResolveEventTransitions(const Config& config, EventTransitions& resolved) {
+  resolved.transitions.clear();
+  resolved.start.clear();
+  resolved.start.reserve(config.events.size() + 1);
+  for (size_t event_idx = 0; event_idx < config.events.size(); ++event_idx) {
+    resolved.start.push_back(resolved.transitions.size());
+    for (const std::string& transition_name : config.events[event_idx].transitions) {
+      auto iter = config.transitions.find(transition_name);
+      if (iter != config.transitions.end()) {
+        resolved.transitions.push_back(&iter->second);
+      } else {
+        ESP_LOGW(TAG, "Event %d: unknown transition '%s'", event_idx, transition_name.c_str());
+        resolved.transitions.push_back(&TWILIGHT_NO_CONFIG_TRANSITION);
+      }
+    }
+  }
+  resolved.start.push_back(resolved.transitions.size());
+  resolved.transitions.shrink_to_fit();
+}
+
 utils::DataOrError<ConfigState> GetConfigState(void) {
   ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.state_lock);
 
@@ -468,6 +1036,28 @@ utils::DataOrError<ConfigState> GetConfigState(void) {
   return config_state;
 }
 
+esp_err_t CopyEventTimeline(EventTimeline& timeline) {
+  ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.timeline_lock);
+  timeline = state_.timeline;
+  return ESP_OK;
+}
+
+utils::DataOrError<LightShowStats> GetLightShowStats(bool reset) {
+  ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.stats_lock);
+
+  LightShowStats stats = state_.stats;
+  stats.wakeups_per_hour = state_.wakeups_per_hour;
+  stats.renderer_fps = TWILIGHT_FPS_STEPS[state_.fps_step];
+  stats.max_fps = TWILIGHT_FPS_STEPS[state_.fps_step_ceiling];
+  stats.driver_suspended = state_.driver_suspended_at.has_value();
+  stats.suppressed_frames += _suppressed_frames();
+  if (reset) {
+    state_.stats = {};
+    if (stats.driver_suspended) state_.driver_suspended_at = xTaskGetTickCount();
+  }
+  return stats;
+}
+
 utils::ESPErrorStatus Setup_Enter(void) {
   ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.state_lock);
   if ((xEventGroupGetBits(state_.status) & TWILIGHT_STATUS_RUNNING) == 0) {
@@ -484,7 +1074,7 @@ utils::ESPErrorStatus Setup_Enter(void) {
   }
 
   // Provide visual indication
-  xEventGroupSetBits(state_.status, TWILIGHT_STATUS_SETUP_PIXELS);
+  xEventGroupSetBits(state_.status, TWILIGHT_STATUS_SETUP_PIXELS | TWILIGHT_STATUS_WAKEUP);
   return ESP_OK;
 }
 
@@ -501,7 +1091,6 @@ utils::ESPErrorStatus Setup_Exit(bool save_changes) {
   if (!config_ && !save_changes) {
     return {"Strip size is not saved"};
   }
-
   if (save_changes) {
     config_ = *state_.config_setup;
     {
@@ -509,19 +1098,24 @@ utils::ESPErrorStatus Setup_Exit(bool save_changes) {
       new_config->twilight = config_;
       ESP_RETURN_ON_ERROR(config::persist());
     }
+    ResolveEventTransitions(config_, state_.event_transitions);
+    ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.timeline_lock);
+    ESP_RETURN_ON_ERROR(state_.timeline.Compile(config_.events));
   } else {
     // Restore current strip setup
     if (state_.config_setup->num_pixels != config_.num_pixels) {
-      auto result = _reconfigure_lightshow(config_);
-      if (result != ESP_OK) {
-        ESP_LOGE(TAG, "LightShow reconfiguration failed!");
-        eventmgr::SetSystemFailed();
+      esp_err_t err = _reconfigure_lightshow(config_);
+      if (err != ESP_OK) {
+        // The renderer is kept at the setup strip size, so remain in setup.
+        ESP_LOGW(TAG, "LightShow reconfiguration failed: %d (0x%x)", err, err);
+        return {err, "Unable to restore strip size"};
       }
     }
   }
 
   xEventGroupClearBits(state_.status, TWILIGHT_STATUS_SETUP_MASK);
   state_.config_setup.reset();
+  xEventGroupSetBits(state_.status, TWILIGHT_STATUS_WAKEUP);
   return ESP_OK;
 }
 
@@ -540,15 +1134,19 @@ utils::ESPErrorStatus Setup_StripSize(size_t num_pixels) {
   }
 
   xEventGroupClearBits(state_.status, TWILIGHT_STATUS_SETUP_MASK);
-  xEventGroupSetBits(state_.status, TWILIGHT_STATUS_SETUP_PIXELS);
+  const size_t prev_num_pixels = state_.config_setup->num_pixels;
   state_.config_setup->num_pixels = num_pixels;
 
-  auto result = _reconfigure_lightshow(*state_.config_setup);
-  if (result != ESP_OK) {
-    ESP_LOGE(TAG, "LightShow reconfiguration failed!");
-    eventmgr::SetSystemFailed();
+  esp_err_t err = _reconfigure_lightshow(*state_.config_setup);
+  if (err != ESP_OK) {
+    // Unless the system failed, the renderer is kept at its previous size, see
+    // `_replace_renderer()`.
+    ESP_LOGW(TAG, "LightShow reconfiguration failed: %d (0x%x)", err, err);
+    state_.config_setup->num_pixels = prev_num_pixels;
+    return {err, "Unable to resize strip"};
   }
 
+  xEventGroupSetBits(state_.status, TWILIGHT_STATUS_SETUP_PIXELS | TWILIGHT_STATUS_WAKEUP);
   return ESP_OK;
 }
 
@@ -565,7 +1163,7 @@ utils::ESPErrorStatus Setup_TestTransition(Config::Transition&& transition) {
   state_.test_transition = std::move(transition);
   state_.test_countdown = TWILIGHT_SETUP_TEST_COUNTS;
 
-  xEventGroupSetBits(state_.status, TWILIGHT_STATUS_INTERRUPT);
+  xEventGroupSetBits(state_.status, TWILIGHT_STATUS_INTERRUPT | TWILIGHT_STATUS_WAKEUP);
   return ESP_OK;
 }
 
@@ -588,6 +1186,9 @@ utils::ESPErrorStatus Set_Events(Config::EventsList&& events) {
   if (!state_.config_setup.has_value()) {
     return {"Not in setup mode"};
   }
+  if (events.size() > MAX_EVENTS) {
+    return {"Too many events"};
+  }
 
   state_.config_setup->events = std::move(events);
 #ifndef NDEBUG
@@ -604,15 +1205,68 @@ utils::ESPErrorStatus Perform_Override(int32_t duration, Config::Transition&& tr
   }
 
   ASSIGN_OR_RETURN(struct tm time_tm, time::GetLocalTime());
-  int32_t second_of_day = get_second_of_day(time_tm);
+  int64_t start_time = get_local_seconds(time_tm) - 1;
 
   // Set override data
   state_.manual_transition = std::move(transition);
-  state_.manual_override = std::make_pair(second_of_day - 1, duration);
+  state_.manual_override =
+      std::make_pair(start_time, (duration > 0) ? (start_time + duration) : -1);
 
-  // Invalidate pre-computed event sequence
-  state_.event_sequence.clear();
+  // Invalidate the current event, and cancel any staged transitions
+  state_.current_event.event_idx = EVENT_IDX_UNINITIALIZED;
+  xEventGroupSetBits(state_.status, TWILIGHT_STATUS_OVERRIDE | TWILIGHT_STATUS_WAKEUP);
+
+  return ESP_OK;
+}
 
+utils::ESPErrorStatus Perform_Live(const Keyframe* keyframes, size_t count) {
+  bool starting;
+  {
+    ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.state_lock);
+    if (state_.config_setup.has_value()) {
+      return {"In setup mode"};
+    }
+
+    if ((starting = !state_.live_until.has_value())) {
+      // Preempt the schedule, and abort any ongoing or staged transitions
+      state_.current_event.event_idx = EVENT_IDX_UNINITIALIZED;
+      xEventGroupSetBits(state_.status, TWILIGHT_STATUS_INTERRUPT | TWILIGHT_STATUS_OVERRIDE |
+                                            TWILIGHT_STATUS_WAKEUP);
+    }
+    state_.live_until = xTaskGetTickCount() + TWILIGHT_LIVE_IDLE_TIMEOUT;
+  }
+
+  ZW_ACQUIRE_FOR_SCOPE_SIMPLE(state_.strip_lock);
+  if (!state_.renderer) {
+    return {"Renderer unavailable"};
+  }
+  const TickType_t now = xTaskGetTickCount();
+  uint32_t played_ms = (now - state_.live_queued_start) * portTICK_PERIOD_MS;
+  if (starting || state_.live_queued_ms <= played_ms) {
+    state_.live_queued_start = now;
+    state_.live_queued_ms = played_ms = 0;
+  }
+  // Keep the renderer queue within the same bound as for events.
+  uint32_t ahead_ms = state_.live_queued_ms - played_ms;
+  for (size_t i = 0; i < count; ++i) {
+    ahead_ms += std::min<uint32_t>(keyframes[i].duration_ms, TWILIGHT_RENDER_AHEAD_MS + 1);
+    if (ahead_ms > TWILIGHT_RENDER_AHEAD_MS) {
+      return {"Live stream too far ahead"};
+    }
+  }
+
+  if (starting && state_.strip_color.has_value()) {
+    // Live keyframes are unknown in advance, play them at the highest sustainable frame rate.
+    // Only switch when the new renderer can pick up from the strip seamlessly.
+    ESP_RETURN_ON_ERROR(_switch_renderer_fps(state_.fps_step_ceiling));
+  }
+  ESP_RETURN_ON_ERROR(_resume_lightshow_driver());
+  state_.strip_color.reset();
+  for (size_t i = 0; i < count; ++i) {
+    ESP_RETURN_ON_ERROR(_enqueue_keyframe(state_.renderer.get(), keyframes[i]));
+    state_.live_queued_ms += keyframes[i].duration_ms;
+  }
+  _stats_queue_depth(state_.live_queued_ms - played_ms);
   return ESP_OK;
 }
 
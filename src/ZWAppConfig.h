@@ -50,6 +50,9 @@ inline constexpr char ZW_STORAGE_MOUNT_POINT[] = "/" _ZW_STORAGE_PART_LABEL;
 
 #endif
 
+// Cache small static files in RAM (+16KB heap at most)
+#define ZW_APPLIANCE_COMPONENT_WEB_ASSET_CACHE
+
 // Enable recursive lock for config access
 // ... so that a task won't block itself performing overlapped locked accesses.
 // For example, calling `persist()` while holding a live `XAppConfig` object.
@@ -0,0 +1,30 @@
+// Host stand-in for `LSPixel.hpp` of the LightShow library, for unit tests.
+
+#ifndef TEST_STUB_LSPIXEL
+#define TEST_STUB_LSPIXEL
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+namespace zw::esp8266::lightshow {
+
+struct RGB888 {
+  uint8_t r, g, b;
+
+  bool operator==(const RGB888& other) const {
+    return r == other.r && g == other.g && b == other.b;
+  }
+  bool operator!=(const RGB888& other) const { return !(*this == other); }
+};
+
+inline std::string to_string(const RGB888& color) {
+  char buf[8];
+  snprintf(buf, sizeof(buf), "#%02x%02x%02x", color.r, color.g, color.b);
+  return buf;
+}
+
+}  // namespace zw::esp8266::lightshow
+
+#endif  // TEST_STUB_LSPIXEL
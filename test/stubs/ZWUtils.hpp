@@ -0,0 +1,119 @@
+// Host stand-in for `ZWUtils.hpp` of the ZWUtils library, for unit tests.
+// Covers the helpers used by the units under test, with the same semantics.
+
+#ifndef TEST_STUB_ZWUTILS
+#define TEST_STUB_ZWUTILS
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esp_err.h"
+
+#define ESP_RETURN_ON_ERROR(x)      \
+  do {                              \
+    esp_err_t __err_rc = (x);       \
+    if (__err_rc != ESP_OK) {       \
+      return __err_rc;              \
+    }                               \
+  } while (0)
+
+#define _ZW_CONCAT_INNER(a, b) a##b
+#define _ZW_CONCAT(a, b) _ZW_CONCAT_INNER(a, b)
+
+#define ASSIGN_OR_RETURN(lhs, expr)                                     \
+  auto _ZW_CONCAT(__result_, __LINE__) = (expr);                        \
+  if (!_ZW_CONCAT(__result_, __LINE__)) {                               \
+    return _ZW_CONCAT(__result_, __LINE__).error();                     \
+  }                                                                     \
+  lhs = std::move(*_ZW_CONCAT(__result_, __LINE__))
+
+namespace zw::esp8266::utils {
+
+template <size_t N>
+constexpr size_t STRLEN(const char (&)[N]) {
+  return N - 1;
+}
+
+template <typename T>
+class DataOrError {
+ public:
+  DataOrError(T data) : data_(std::move(data)) {}
+  DataOrError(esp_err_t error) : error_(error) {}
+
+  explicit operator bool() const { return data_.has_value(); }
+  esp_err_t error() const { return error_; }
+
+  T& operator*() { return *data_; }
+  const T& operator*() const { return *data_; }
+  T* operator->() { return &*data_; }
+  const T* operator->() const { return &*data_; }
+
+ private:
+  std::optional<T> data_;
+  esp_err_t error_ = ESP_OK;
+};
+
+struct ESPErrorStatus {
+  esp_err_t error;
+  std::string message;
+
+  ESPErrorStatus(esp_err_t error = ESP_OK) : error(error) {}
+  ESPErrorStatus(const char* message) : error(ESP_FAIL), message(message) {}
+  ESPErrorStatus(esp_err_t error, const char* message) : error(error), message(message) {}
+
+  explicit operator bool() const { return error == ESP_OK; }
+};
+
+template <typename T>
+class AutoReleaseRes {
+ public:
+  using Releaser = std::function<void(T)>;
+
+  AutoReleaseRes(void) = default;
+  AutoReleaseRes(T res, Releaser releaser) : res_(res), releaser_(std::move(releaser)) {}
+  AutoReleaseRes(AutoReleaseRes&& other)
+      : res_(other.Drop()), releaser_(std::move(other.releaser_)) {}
+  AutoReleaseRes& operator=(AutoReleaseRes&& other) {
+    _Release();
+    res_ = other.Drop();
+    releaser_ = std::move(other.releaser_);
+    return *this;
+  }
+  ~AutoReleaseRes(void) { _Release(); }
+
+  T& operator*() { return res_; }
+  T Drop(void) { return std::exchange(res_, T{}); }
+
+ private:
+  void _Release(void) {
+    if (releaser_) releaser_(Drop());
+  }
+
+  T res_{};
+  Releaser releaser_;
+};
+
+class DataBuf : public std::vector<uint8_t> {
+ public:
+  explicit DataBuf(size_t size) : std::vector<uint8_t>(size) {}
+
+  const char* PrintTo(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf((char*)data(), size(), format, args);
+    va_end(args);
+    return (const char*)data();
+  }
+};
+
+}  // namespace zw::esp8266::utils
+
+#endif  // TEST_STUB_ZWUTILS
@@ -0,0 +1,18 @@
+// Host stand-in for `cJSON.h`, for unit tests.
+// The units under test only pass JSON objects around, so none is ever created.
+
+#ifndef TEST_STUB_CJSON
+#define TEST_STUB_CJSON
+
+#include <stddef.h>
+
+typedef struct cJSON cJSON;
+typedef int cJSON_bool;
+
+inline cJSON* cJSON_ParseWithOpts(const char*, const char**, cJSON_bool) { return NULL; }
+inline const char* cJSON_GetErrorPtr(void) { return NULL; }
+inline char* cJSON_Print(const cJSON*) { return NULL; }
+inline void cJSON_free(void*) {}
+inline void cJSON_Delete(cJSON*) {}
+
+#endif  // TEST_STUB_CJSON
@@ -0,0 +1,22 @@
+// Host stand-in for `esp_err.h` of the ESP8266 RTOS SDK, for unit tests.
+
+#ifndef TEST_STUB_ESP_ERR
+#define TEST_STUB_ESP_ERR
+
+#include <stdint.h>
+
+typedef int32_t esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+#define ESP_ERR_INVALID_VERSION 0x10A
+
+#endif  // TEST_STUB_ESP_ERR
@@ -0,0 +1,12 @@
+// Host stand-in for `esp_event_base.h` of the ESP8266 RTOS SDK, for unit tests.
+
+#ifndef TEST_STUB_ESP_EVENT_BASE
+#define TEST_STUB_ESP_EVENT_BASE
+
+#include <stdint.h>
+
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void* event_handler_arg, esp_event_base_t event_base,
+                                    int32_t event_id, void* event_data);
+
+#endif  // TEST_STUB_ESP_EVENT_BASE
@@ -0,0 +1,71 @@
+// Host stand-in for `esp_http_server.h` of the ESP8266 RTOS SDK, for unit tests.
+// Request headers are set up by the test; nothing is ever sent.
+
+#ifndef TEST_STUB_ESP_HTTP_SERVER
+#define TEST_STUB_ESP_HTTP_SERVER
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <map>
+#include <string>
+
+#include "esp_err.h"
+
+#define ESP_ERR_HTTPD_BASE 0x8000
+#define ESP_ERR_HTTPD_RESULT_TRUNC (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESP_SEND (ESP_ERR_HTTPD_BASE + 5)
+
+#define HTTPD_RESP_USE_STRLEN -1
+#define HTTPD_TYPE_JSON "application/json"
+
+typedef void* httpd_handle_t;
+
+typedef enum {
+  HTTPD_400_BAD_REQUEST,
+  HTTPD_500_INTERNAL_SERVER_ERROR,
+} httpd_err_code_t;
+
+typedef struct httpd_req {
+  int method;
+  const char uri[64];
+  size_t content_len;
+  std::map<std::string, std::string> headers;
+} httpd_req_t;
+
+inline size_t httpd_req_get_hdr_value_len(httpd_req_t* r, const char* field) {
+  auto iter = r->headers.find(field);
+  return iter == r->headers.end() ? 0 : iter->second.length();
+}
+
+inline esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* r, const char* field, char* val,
+                                             size_t val_size) {
+  auto iter = r->headers.find(field);
+  if (iter == r->headers.end()) return ESP_ERR_NOT_FOUND;
+  strncpy(val, iter->second.c_str(), val_size);
+  if (val_size <= iter->second.length()) {
+    val[val_size - 1] = '\0';
+    return ESP_ERR_HTTPD_RESULT_TRUNC;
+  }
+  return ESP_OK;
+}
+
+inline esp_err_t httpd_query_key_value(const char*, const char*, char*, size_t*) {
+  return ESP_ERR_NOT_FOUND;
+}
+
+inline int httpd_req_recv(httpd_req_t*, char*, size_t) { return -1; }
+inline int httpd_send(httpd_req_t*, const char*, size_t) { return -1; }
+
+inline esp_err_t httpd_resp_set_status(httpd_req_t*, const char*) { return ESP_OK; }
+inline esp_err_t httpd_resp_set_type(httpd_req_t*, const char*) { return ESP_OK; }
+inline esp_err_t httpd_resp_set_hdr(httpd_req_t*, const char*, const char*) { return ESP_OK; }
+inline esp_err_t httpd_resp_send(httpd_req_t*, const char*, ssize_t) {
+  return ESP_ERR_HTTPD_RESP_SEND;
+}
+inline esp_err_t httpd_resp_send_err(httpd_req_t*, httpd_err_code_t, const char*) {
+  return ESP_ERR_HTTPD_RESP_SEND;
+}
+
+#endif  // TEST_STUB_ESP_HTTP_SERVER
@@ -0,0 +1,31 @@
+// Host stand-in for `esp_log.h` of the ESP8266 RTOS SDK, for unit tests.
+// Only warnings and errors are printed, to keep the test output readable.
+
+#ifndef TEST_STUB_ESP_LOG
+#define TEST_STUB_ESP_LOG
+
+#include <stdio.h>
+
+typedef enum {
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+// The arguments are still compiled, as for a log level disabled at runtime.
+#define _TEST_STUB_LOG_QUIET(tag, format, ...)                     \
+  do {                                                              \
+    if (0) fprintf(stderr, "%s: " format "\n", tag, ##__VA_ARGS__); \
+  } while (0)
+#define ESP_LOGI(tag, format, ...) _TEST_STUB_LOG_QUIET(tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) _TEST_STUB_LOG_QUIET(tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) _TEST_STUB_LOG_QUIET(tag, format, ##__VA_ARGS__)
+
+#define ESP_LOG_BUFFER_HEXDUMP(tag, buffer, buff_len, level) ((void)(tag))
+
+#endif  // TEST_STUB_ESP_LOG
@@ -0,0 +1,8 @@
+// Host stand-in for `esp_spi_flash.h` of the ESP8266 RTOS SDK, for unit tests.
+
+#ifndef TEST_STUB_ESP_SPI_FLASH
+#define TEST_STUB_ESP_SPI_FLASH
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+#endif  // TEST_STUB_ESP_SPI_FLASH
@@ -0,0 +1,15 @@
+// Host stand-in for `esp_system.h` of the ESP8266 RTOS SDK, for unit tests.
+
+#ifndef TEST_STUB_ESP_SYSTEM
+#define TEST_STUB_ESP_SYSTEM
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Plenty, unless a test says otherwise.
+inline uint32_t test_stub_free_heap_size = 64 * 1024;
+
+inline uint32_t esp_get_free_heap_size(void) { return test_stub_free_heap_size; }
+
+#endif  // TEST_STUB_ESP_SYSTEM
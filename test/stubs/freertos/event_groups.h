@@ -0,0 +1,11 @@
+// Host stand-in for `freertos/event_groups.h` of the ESP8266 RTOS SDK, for unit tests.
+
+#ifndef TEST_STUB_FREERTOS_EVENT_GROUPS
+#define TEST_STUB_FREERTOS_EVENT_GROUPS
+
+#include "freertos/FreeRTOS.h"
+
+typedef TickType_t EventBits_t;
+typedef void* EventGroupHandle_t;
+
+#endif  // TEST_STUB_FREERTOS_EVENT_GROUPS
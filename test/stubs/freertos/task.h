@@ -0,0 +1,17 @@
+// Host stand-in for `freertos/task.h` of the ESP8266 RTOS SDK, for unit tests.
+// The tick count only moves when a test advances it.
+
+#ifndef TEST_STUB_FREERTOS_TASK
+#define TEST_STUB_FREERTOS_TASK
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+
+inline TickType_t test_stub_tick_count = 0;
+
+inline TickType_t xTaskGetTickCount(void) { return test_stub_tick_count; }
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+#endif  // TEST_STUB_FREERTOS_TASK
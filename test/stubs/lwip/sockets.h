@@ -0,0 +1,50 @@
+// Host stand-in for `lwip/sockets.h`, for unit tests.
+// None of the socket functions succeeds.
+
+#ifndef TEST_STUB_LWIP_SOCKETS
+#define TEST_STUB_LWIP_SOCKETS
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+typedef uint8_t sa_family_t;
+typedef uint16_t in_port_t;
+typedef uint32_t in_addr_t;
+typedef uint32_t socklen_t;
+
+struct in_addr {
+  in_addr_t s_addr;
+};
+
+struct sockaddr {
+  uint8_t sa_len;
+  sa_family_t sa_family;
+  char sa_data[14];
+};
+
+struct sockaddr_in {
+  uint8_t sin_len;
+  sa_family_t sin_family;
+  in_port_t sin_port;
+  struct in_addr sin_addr;
+  char sin_zero[8];
+};
+
+#define AF_INET 2
+#define SOCK_DGRAM 2
+#define SOL_SOCKET 0xfff
+#define SO_RCVTIMEO 0x1006
+#define INADDR_ANY ((in_addr_t)0x00000000UL)
+
+inline uint16_t htons(uint16_t n) { return (uint16_t)((n << 8) | (n >> 8)); }
+
+inline int socket(int, int, int) { return -1; }
+inline int bind(int, const struct sockaddr*, socklen_t) { return -1; }
+inline ssize_t recv(int, void*, size_t, int) { return -1; }
+inline int setsockopt(int, int, int, const void*, socklen_t) { return -1; }
+inline int close(int) { return -1; }
+
+#endif  // TEST_STUB_LWIP_SOCKETS
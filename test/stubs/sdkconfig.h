@@ -0,0 +1,8 @@
+// Host stand-in for the generated `sdkconfig.h`, for unit tests.
+
+#ifndef TEST_STUB_SDKCONFIG
+#define TEST_STUB_SDKCONFIG
+
+#define CONFIG_FREERTOS_HZ 100
+
+#endif  // TEST_STUB_SDKCONFIG
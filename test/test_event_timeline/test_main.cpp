@@ -0,0 +1,390 @@
+// Host-side unit tests of the event timeline.
+// The local time given to a lookup is built with `timegm()`, so no time zone is involved;
+// DST transitions are simulated by their jumps in the local wall clock.
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <new>
+
+#include <unity.h>
+
+#include "TWiLight/EventSequencer.cpp"
+
+// Heap allocations are counted while `counting_allocations_` is set.
+bool counting_allocations_ = false;
+size_t allocations_ = 0;
+
+void* operator new(size_t size) {
+  if (counting_allocations_) ++allocations_;
+  if (void* ptr = malloc(size ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+namespace zw::esp8266::app::twilight {
+
+// Provided by `Config.cpp`, which is not part of the test.
+std::string print_time(uint16_t time) {
+  return utils::DataBuf(8).PrintTo("%02d:%02d", time / 60, time % 60);
+}
+std::string print_event(const Config::Event& event) { return "event"; }
+
+namespace {
+
+inline constexpr uint16_t NO_END = UINT16_MAX;
+
+uint16_t _hm(int hour, int minute) { return hour * 60 + minute; }
+
+struct tm _local_time(int year, int month, int day, int hour, int minute, int second = 0) {
+  struct tm time_tm = {};
+  time_tm.tm_year = year - 1900;
+  time_tm.tm_mon = month - 1;
+  time_tm.tm_mday = day;
+  time_tm.tm_hour = hour;
+  time_tm.tm_min = minute;
+  time_tm.tm_sec = second;
+  // Normalize, and fill in the day of week and year.
+  time_t time = timegm(&time_tm);
+  gmtime_r(&time, &time_tm);
+  return time_tm;
+}
+
+int64_t _local_seconds(int year, int month, int day, int hour, int minute, int second = 0) {
+  return get_local_seconds(_local_time(year, month, day, hour, minute, second));
+}
+
+Config::Event::TimeRange _range(uint16_t start, uint16_t end) {
+  return {.start = start, .end = (end == NO_END) ? uint16_t{0} : end, .has_end = end != NO_END};
+}
+
+Config::Event _daily(uint16_t start, uint16_t end) {
+  Config::Event event = {};
+  event.type = Config::Event::Type::RECURRENT_DAILY;
+  event.daily = _range(start, end);
+  event.transitions = {"test"};
+  return event;
+}
+
+Config::Event _weekly(Config::Event::Weekly::Day day, uint16_t start, uint16_t end) {
+  Config::Event event = {};
+  event.type = Config::Event::Type::RECURRENT_WEEKLY;
+  static_cast<Config::Event::TimeRange&>(event.weekly) = _range(start, end);
+  event.weekly.days = static_cast<uint8_t>(day);
+  event.transitions = {"test"};
+  return event;
+}
+
+Config::Event _annual(int month, int day, uint16_t start, uint16_t end) {
+  Config::Event event = {};
+  event.type = Config::Event::Type::RECURRENT_ANNUAL;
+  static_cast<Config::Event::TimeRange&>(event.annual) = _range(start, end);
+  event.annual.date = {.month_idx = static_cast<uint8_t>(month - 1),
+                       .day = static_cast<uint8_t>(day)};
+  event.transitions = {"test"};
+  return event;
+}
+
+TimelineEntry _lookup(EventTimeline& timeline, const struct tm& time_tm) {
+  auto entry = timeline.Lookup(time_tm);
+  TEST_ASSERT_TRUE(entry);
+  return *entry;
+}
+
+}  // namespace
+
+void test_year_day_number(void) {
+  TEST_ASSERT_EQUAL_INT32(0, _year_day_number(70));
+  TEST_ASSERT_EQUAL_INT32(10957, _year_day_number(100));
+  TEST_ASSERT_EQUAL_INT32(19358, _year_day_number(123));
+  TEST_ASSERT_EQUAL_INT32(19723, _year_day_number(124));
+  TEST_ASSERT_EQUAL_INT32(47482, _year_day_number(200));
+
+  TEST_ASSERT_EQUAL_INT32(19782, get_day_number(_local_time(2024, 2, 29, 12, 0)));
+  TEST_ASSERT_EQUAL_INT32(20093, get_day_number(_local_time(2025, 1, 5, 0, 0)));
+}
+
+void test_day_of_year(void) {
+  TEST_ASSERT_EQUAL_INT(59, _day_of_year(124, {.month_idx = 1, .day = 29}));
+  TEST_ASSERT_EQUAL_INT(60, _day_of_year(124, {.month_idx = 2, .day = 1}));
+  TEST_ASSERT_EQUAL_INT(365, _day_of_year(124, {.month_idx = 11, .day = 31}));
+  TEST_ASSERT_EQUAL_INT(59, _day_of_year(123, {.month_idx = 2, .day = 1}));
+  TEST_ASSERT_EQUAL_INT(364, _day_of_year(123, {.month_idx = 11, .day = 31}));
+  // Leap days only exist in leap years, centuries only every 400 years.
+  TEST_ASSERT_EQUAL_INT(-1, _day_of_year(123, {.month_idx = 1, .day = 29}));
+  TEST_ASSERT_EQUAL_INT(-1, _day_of_year(200, {.month_idx = 1, .day = 29}));
+  TEST_ASSERT_EQUAL_INT(59, _day_of_year(100, {.month_idx = 1, .day = 29}));
+  // Invalid dates
+  TEST_ASSERT_EQUAL_INT(-1, _day_of_year(124, {.month_idx = 3, .day = 31}));
+  TEST_ASSERT_EQUAL_INT(-1, _day_of_year(124, {.month_idx = 12, .day = 1}));
+  TEST_ASSERT_EQUAL_INT(-1, _day_of_year(124, {.month_idx = 0, .day = 0}));
+}
+
+void test_daily_event(void) {
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(ESP_OK, timeline.Compile({_daily(_hm(18, 0), _hm(22, 0))}));
+
+  TimelineEntry entry = _lookup(timeline, _local_time(2024, 3, 6, 19, 0));
+  TEST_ASSERT_EQUAL_INT16(0, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 6, 18, 0), entry.last_start);
+  // The end time is inclusive of its minute.
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 6, 22, 0, 59), entry.completion);
+
+  entry = _lookup(timeline, _local_time(2024, 3, 6, 23, 0));
+  TEST_ASSERT_EQUAL_INT16(EVENT_IDX_UNCONFIGURED, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 6, 18, 0), entry.last_start);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 7, 18, 0), entry.completion);
+}
+
+void test_no_events(void) {
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(ESP_OK, timeline.Compile({}));
+
+  TimelineEntry entry = _lookup(timeline, _local_time(2024, 3, 6, 12, 0));
+  TEST_ASSERT_EQUAL_INT16(EVENT_IDX_UNCONFIGURED, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(TIMELINE_NO_START, entry.last_start);
+  // Completes at the end of the week (Saturday midnight).
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 10, 0, 0), entry.completion);
+}
+
+void test_too_many_events(void) {
+  EventTimeline timeline;
+  Config::EventsList events(MAX_EVENTS + 1, _daily(_hm(8, 0), _hm(9, 0)));
+  TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_SIZE, timeline.Compile(events));
+}
+
+void test_max_events(void) {
+  // Mostly annual events on another date, which only take part in the folding.
+  Config::EventsList events(MAX_EVENTS, _annual(7, 4, _hm(20, 0), _hm(23, 0)));
+  events[5] = _daily(_hm(8, 0), _hm(12, 0));
+  events[40] = _daily(_hm(9, 0), _hm(10, 0));
+  events[200] = _daily(_hm(9, 30), _hm(11, 0));
+  events[MAX_EVENTS - 1] = _weekly(Config::Event::Weekly::Day::WEDNESDAY, _hm(10, 30), _hm(10, 45));
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(ESP_OK, timeline.Compile(events));
+
+  TEST_ASSERT_EQUAL_INT16(5, _lookup(timeline, _local_time(2024, 3, 6, 8, 30)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(40, _lookup(timeline, _local_time(2024, 3, 6, 9, 15)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(200, _lookup(timeline, _local_time(2024, 3, 6, 9, 45)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(MAX_EVENTS - 1,
+                          _lookup(timeline, _local_time(2024, 3, 6, 10, 40)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(200, _lookup(timeline, _local_time(2024, 3, 6, 10, 50)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(5, _lookup(timeline, _local_time(2024, 3, 6, 11, 30)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(200, _lookup(timeline, _local_time(2024, 3, 7, 10, 40)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(MAX_EVENTS - 2,
+                          _lookup(timeline, _local_time(2024, 7, 4, 21, 0)).event_idx);
+}
+
+void test_highest_index_wins(void) {
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(
+      ESP_OK, timeline.Compile({_daily(_hm(10, 0), _hm(14, 0)), _daily(_hm(12, 0), _hm(13, 0))}));
+
+  TEST_ASSERT_EQUAL_INT16(0, _lookup(timeline, _local_time(2024, 3, 6, 11, 0)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(1, _lookup(timeline, _local_time(2024, 3, 6, 12, 30)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(0, _lookup(timeline, _local_time(2024, 3, 6, 13, 30)).event_idx);
+}
+
+void test_open_ended_until_next_start(void) {
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(
+      ESP_OK, timeline.Compile({_daily(_hm(20, 0), NO_END),
+                                _weekly(Config::Event::Weekly::Day::MONDAY, _hm(7, 0), _hm(8, 0))}));
+
+  // Carried over from Sunday evening, across the start of the week.
+  TimelineEntry entry = _lookup(timeline, _local_time(2024, 3, 11, 3, 0));
+  TEST_ASSERT_EQUAL_INT16(0, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 10, 20, 0), entry.last_start);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 11, 7, 0), entry.completion);
+
+  TEST_ASSERT_EQUAL_INT16(1, _lookup(timeline, _local_time(2024, 3, 11, 7, 30)).event_idx);
+  // The open-ended event was ended by the Monday event.
+  TEST_ASSERT_EQUAL_INT16(EVENT_IDX_UNCONFIGURED,
+                          _lookup(timeline, _local_time(2024, 3, 11, 9, 0)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(0, _lookup(timeline, _local_time(2024, 3, 12, 3, 0)).event_idx);
+}
+
+void test_weekly_wraps_into_next_week(void) {
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(ESP_OK, timeline.Compile({_weekly(Config::Event::Weekly::Day::SATURDAY,
+                                                          _hm(23, 0), _hm(1, 0))}));
+
+  TimelineEntry entry = _lookup(timeline, _local_time(2024, 3, 10, 0, 30));
+  TEST_ASSERT_EQUAL_INT16(0, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 9, 23, 0), entry.last_start);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 10, 1, 0, 59), entry.completion);
+
+  entry = _lookup(timeline, _local_time(2024, 3, 16, 23, 30));
+  TEST_ASSERT_EQUAL_INT16(0, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 16, 23, 0), entry.last_start);
+  // The segment runs to the end of the week, and is picked up by the following one.
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 17, 0, 0), entry.completion);
+}
+
+void test_annual_leap_day(void) {
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(ESP_OK, timeline.Compile({_annual(2, 29, _hm(10, 0), _hm(11, 0))}));
+
+  TEST_ASSERT_EQUAL_INT16(0, _lookup(timeline, _local_time(2024, 2, 29, 10, 30)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(EVENT_IDX_UNCONFIGURED,
+                          _lookup(timeline, _local_time(2024, 3, 1, 10, 30)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(EVENT_IDX_UNCONFIGURED,
+                          _lookup(timeline, _local_time(2023, 3, 1, 10, 30)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(EVENT_IDX_UNCONFIGURED,
+                          _lookup(timeline, _local_time(2100, 3, 1, 10, 30)).event_idx);
+  TEST_ASSERT_EQUAL_INT16(0, _lookup(timeline, _local_time(2028, 2, 29, 10, 30)).event_idx);
+}
+
+void test_annual_carries_over_new_year(void) {
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(ESP_OK, timeline.Compile({_annual(12, 31, _hm(20, 0), NO_END),
+                                                  _annual(12, 31, _hm(23, 0), _hm(1, 0))}));
+
+  // The week straddles two years.
+  TimelineEntry entry = _lookup(timeline, _local_time(2025, 1, 1, 0, 30));
+  TEST_ASSERT_EQUAL_INT16(1, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 12, 31, 23, 0), entry.last_start);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2025, 1, 1, 1, 0, 59), entry.completion);
+
+  // Open-ended events are only ended by another start, even months later.
+  entry = _lookup(timeline, _local_time(2025, 6, 1, 12, 0));
+  TEST_ASSERT_EQUAL_INT16(EVENT_IDX_UNCONFIGURED, entry.event_idx);
+
+  TEST_ASSERT_EQUAL_INT(ESP_OK, timeline.Compile({_annual(12, 31, _hm(20, 0), NO_END)}));
+  entry = _lookup(timeline, _local_time(2025, 6, 1, 12, 0));
+  TEST_ASSERT_EQUAL_INT16(0, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 12, 31, 20, 0), entry.last_start);
+}
+
+void test_extend_matches_rebuild(void) {
+  const Config::EventsList events = {
+      _daily(_hm(20, 0), NO_END),
+      _weekly(Config::Event::Weekly::Day::SATURDAY, _hm(23, 0), _hm(1, 0)),
+      _weekly(Config::Event::Weekly::Day::SUNDAY, _hm(6, 0), NO_END),
+      _annual(12, 31, _hm(22, 0), _hm(2, 0)),
+      _annual(1, 1, _hm(0, 0), NO_END),
+      _annual(2, 29, _hm(12, 0), _hm(13, 0)),
+  };
+  // Looked up in sequence, the timeline extends from one week into the next.
+  EventTimeline extended;
+  TEST_ASSERT_EQUAL_INT(ESP_OK, extended.Compile(events));
+
+  const int64_t from = _local_seconds(2024, 12, 1, 0, 0);
+  const int64_t to = _local_seconds(2025, 3, 8, 0, 0);
+  for (int64_t seconds = from; seconds < to; seconds += 37 * 60) {
+    time_t time = seconds;
+    struct tm time_tm;
+    gmtime_r(&time, &time_tm);
+
+    EventTimeline rebuilt;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rebuilt.Compile(events));
+    TimelineEntry expected = _lookup(rebuilt, time_tm);
+    TimelineEntry actual = _lookup(extended, time_tm);
+    TEST_ASSERT_EQUAL_INT16(expected.event_idx, actual.event_idx);
+    TEST_ASSERT_EQUAL_INT64(expected.last_start, actual.last_start);
+    TEST_ASSERT_EQUAL_INT64(expected.completion, actual.completion);
+    TEST_ASSERT_TRUE(actual.completion > seconds);
+  }
+}
+
+void test_beyond_2038(void) {
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(ESP_OK, timeline.Compile({_daily(_hm(18, 0), _hm(22, 0))}));
+
+  // Past the end of 32-bit seconds since 1970, on 2038-01-19.
+  TimelineEntry entry = _lookup(timeline, _local_time(2038, 1, 19, 19, 0));
+  TEST_ASSERT_EQUAL_INT16(0, entry.event_idx);
+  TEST_ASSERT_TRUE(entry.completion > INT32_MAX);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2038, 1, 19, 18, 0), entry.last_start);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2038, 1, 19, 22, 0, 59), entry.completion);
+
+  entry = _lookup(timeline, _local_time(2100, 3, 1, 23, 0));
+  TEST_ASSERT_EQUAL_INT16(EVENT_IDX_UNCONFIGURED, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2100, 3, 1, 18, 0), entry.last_start);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2100, 3, 2, 18, 0), entry.completion);
+}
+
+void test_lookups_do_not_allocate(void) {
+  const Config::EventsList events = {
+      _daily(_hm(20, 0), NO_END),
+      _weekly(Config::Event::Weekly::Day::SATURDAY, _hm(23, 0), _hm(1, 0)),
+      _annual(12, 24, _hm(18, 0), NO_END),
+      _annual(12, 31, _hm(22, 0), _hm(2, 0)),
+      _annual(1, 1, _hm(0, 0), NO_END),
+  };
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(ESP_OK, timeline.Compile(events));
+
+  // Rebuilds the first week, then extends into the following ones.
+  allocations_ = 0;
+  counting_allocations_ = true;
+  const int64_t from = _local_seconds(2024, 12, 1, 0, 0);
+  const int64_t to = _local_seconds(2025, 2, 1, 0, 0);
+  for (int64_t seconds = from; seconds < to; seconds += 5 * SECONDS_IN_AN_HOUR) {
+    time_t time = seconds;
+    struct tm time_tm;
+    gmtime_r(&time, &time_tm);
+    _lookup(timeline, time_tm);
+  }
+  // And rebuilds again, further away.
+  _lookup(timeline, _local_time(2024, 6, 1, 12, 0));
+  counting_allocations_ = false;
+  TEST_ASSERT_EQUAL_size_t(0, allocations_);
+}
+
+void test_dst_transitions(void) {
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL_INT(
+      ESP_OK, timeline.Compile({_daily(_hm(1, 30), _hm(2, 30)), _daily(_hm(2, 15), NO_END)}));
+
+  // Spring forward: the wall clock jumps from 02:00 to 03:00, skipping the start at 02:15.
+  TimelineEntry entry = _lookup(timeline, _local_time(2024, 3, 10, 1, 45));
+  TEST_ASSERT_EQUAL_INT16(0, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 10, 2, 15), entry.completion);
+  entry = _lookup(timeline, _local_time(2024, 3, 10, 3, 0));
+  TEST_ASSERT_EQUAL_INT16(1, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 3, 10, 2, 15), entry.last_start);
+
+  // Fall back: the wall clock repeats 01:00 to 02:00, and so do the lookups.
+  entry = _lookup(timeline, _local_time(2024, 11, 3, 1, 45));
+  TEST_ASSERT_EQUAL_INT16(0, entry.event_idx);
+  entry = _lookup(timeline, _local_time(2024, 11, 3, 1, 10));
+  TEST_ASSERT_EQUAL_INT16(1, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 11, 2, 2, 15), entry.last_start);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 11, 3, 1, 30), entry.completion);
+  entry = _lookup(timeline, _local_time(2024, 11, 3, 1, 45));
+  TEST_ASSERT_EQUAL_INT16(0, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 11, 3, 1, 30), entry.last_start);
+
+  // Moving back into the previous week rebuilds it.
+  entry = _lookup(timeline, _local_time(2024, 11, 2, 23, 30));
+  TEST_ASSERT_EQUAL_INT16(1, entry.event_idx);
+  TEST_ASSERT_EQUAL_INT64(_local_seconds(2024, 11, 2, 2, 15), entry.last_start);
+}
+
+}  // namespace zw::esp8266::app::twilight
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int main(int argc, char** argv) {
+  using namespace zw::esp8266::app::twilight;
+  UNITY_BEGIN();
+  RUN_TEST(test_year_day_number);
+  RUN_TEST(test_day_of_year);
+  RUN_TEST(test_no_events);
+  RUN_TEST(test_too_many_events);
+  RUN_TEST(test_daily_event);
+  RUN_TEST(test_max_events);
+  RUN_TEST(test_highest_index_wins);
+  RUN_TEST(test_open_ended_until_next_start);
+  RUN_TEST(test_weekly_wraps_into_next_week);
+  RUN_TEST(test_annual_leap_day);
+  RUN_TEST(test_annual_carries_over_new_year);
+  RUN_TEST(test_extend_matches_rebuild);
+  RUN_TEST(test_beyond_2038);
+  RUN_TEST(test_lookups_do_not_allocate);
+  RUN_TEST(test_dst_transitions);
+  return UNITY_END();
+}
@@ -0,0 +1,85 @@
+// Host-side unit tests of the fixed-point fractions.
+
+#include <unity.h>
+
+#include "TWiLight/FixedPoint.hpp"
+
+namespace zw::esp8266::app::twilight {
+
+namespace {
+
+void _assert_decoded(uint16_t expected, const char* str) {
+  auto value = decode_permille(str);
+  TEST_ASSERT_TRUE(value);
+  TEST_ASSERT_EQUAL_UINT16(expected, *value);
+}
+
+void _assert_rejected(const char* str) {
+  auto value = decode_permille(str);
+  TEST_ASSERT_FALSE(value);
+  TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, value.error());
+}
+
+}  // namespace
+
+void test_decode_permille(void) {
+  _assert_decoded(300, "0.3");
+  _assert_decoded(300, ".3");
+  _assert_decoded(250, "0.25");
+  _assert_decoded(1, "0.001");
+  _assert_decoded(1000, "1");
+  _assert_decoded(1000, "1.");
+  _assert_decoded(0, "0");
+  _assert_decoded(12345, "12.345");
+  // Digits beyond the third decimal place are dropped.
+  _assert_decoded(123, "0.1239");
+  _assert_decoded(0, "0.0009");
+}
+
+void test_decode_permille_limits(void) {
+  _assert_decoded(UINT16_MAX, "65.535");
+  _assert_rejected("65.536");
+  _assert_rejected("66");
+  _assert_rejected("100000");
+}
+
+void test_decode_permille_malformed(void) {
+  _assert_rejected("");
+  _assert_rejected(".");
+  _assert_rejected("-0.5");
+  _assert_rejected("+1");
+  _assert_rejected("0.5x");
+  _assert_rejected("1.2.3");
+  _assert_rejected(" 1");
+}
+
+void test_encode_permille(void) {
+  TEST_ASSERT_EQUAL_STRING("0.300", encode_permille(300).c_str());
+  TEST_ASSERT_EQUAL_STRING("0.001", encode_permille(1).c_str());
+  TEST_ASSERT_EQUAL_STRING("1.000", encode_permille(1000).c_str());
+  TEST_ASSERT_EQUAL_STRING("65.535", encode_permille(UINT16_MAX).c_str());
+}
+
+void test_permille_round_trip(void) {
+  for (uint32_t value = 0; value <= UINT16_MAX; value += 7) {
+    auto decoded = decode_permille(encode_permille(value).c_str());
+    TEST_ASSERT_TRUE(decoded);
+    TEST_ASSERT_EQUAL_UINT16(value, *decoded);
+  }
+}
+
+}  // namespace zw::esp8266::app::twilight
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int main(int argc, char** argv) {
+  using namespace zw::esp8266::app::twilight;
+  UNITY_BEGIN();
+  RUN_TEST(test_decode_permille);
+  RUN_TEST(test_decode_permille_limits);
+  RUN_TEST(test_decode_permille_malformed);
+  RUN_TEST(test_encode_permille);
+  RUN_TEST(test_permille_round_trip);
+  return UNITY_END();
+}
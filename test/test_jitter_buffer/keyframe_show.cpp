@@ -0,0 +1,3 @@
+// Keyframe decoding, as used by the live stream, built as its own unit.
+
+#include "TWiLight/KeyframeShow.cpp"
@@ -0,0 +1,270 @@
+// Host-side unit tests of the live stream jitter buffer.
+// The light show is replaced by a recorder of the datagrams played, and the tick count
+// only moves when a test advances it.
+
+#include <vector>
+
+#include <unity.h>
+
+#include "TWiLight/LiveStream.cpp"
+
+namespace zw::esp8266::app {
+
+namespace eventmgr {
+
+EventBits_t system_states_peek(EventBits_t states) { return 0; }
+void SetSystemFailed(void) { TEST_ASSERT_TRUE_MESSAGE(false, "System failed"); }
+
+}  // namespace eventmgr
+
+namespace twilight {
+
+namespace {
+
+// The duration of the first keyframe of each datagram played, which carries its sequence.
+std::vector<uint32_t> played_;
+bool refuse_live_ = false;
+
+uint32_t _keyframe_tag(uint16_t sequence) { return 1000 + sequence; }
+
+// Receive a datagram of a single no-op keyframe.
+void _receive(JitterBuffer& buffer, uint16_t sequence) {
+  Datagram* datagram = buffer.Receiving();
+  uint8_t* data = datagram->data;
+  memset(data, 0, LIVE_HEADER_SIZE + SHOW_KEYFRAME_SIZE);
+  memcpy(data, LIVE_MAGIC, sizeof(LIVE_MAGIC));
+  data[4] = sequence & 0xff;
+  data[5] = sequence >> 8;
+  data[6] = 1;
+  const uint32_t tag = _keyframe_tag(sequence);
+  for (int i = 0; i < 4; ++i) data[LIVE_HEADER_SIZE + 4 + i] = tag >> (i * 8);
+  TEST_ASSERT_TRUE(_valid_datagram(data, LIVE_HEADER_SIZE + SHOW_KEYFRAME_SIZE));
+  buffer.Accept(sequence);
+}
+
+void _assert_played(const std::vector<uint16_t>& sequences) {
+  TEST_ASSERT_EQUAL_size_t(sequences.size(), played_.size());
+  for (size_t i = 0; i < sequences.size(); ++i) {
+    TEST_ASSERT_EQUAL_UINT32(_keyframe_tag(sequences[i]), played_[i]);
+  }
+}
+
+void _advance_ms(uint32_t ms) { test_stub_tick_count += ms / portTICK_PERIOD_MS; }
+
+}  // namespace
+
+utils::ESPErrorStatus Perform_Live(const Keyframe* keyframes, size_t count) {
+  TEST_ASSERT_EQUAL_size_t(1, count);
+  if (refuse_live_) return {"Refused"};
+  played_.push_back(keyframes[0].duration_ms);
+  return ESP_OK;
+}
+
+void test_in_order(void) {
+  JitterBuffer buffer;
+  TEST_ASSERT_FALSE(buffer.started());
+  TEST_ASSERT_EQUAL_UINT32(portMAX_DELAY, buffer.HoldTicks());
+
+  for (uint16_t sequence = 5; sequence < 15; ++sequence) {
+    _receive(buffer, sequence);
+    buffer.Drain();
+  }
+  TEST_ASSERT_TRUE(buffer.started());
+  _assert_played({5, 6, 7, 8, 9, 10, 11, 12, 13, 14});
+
+  StreamStats stats = buffer.Finish();
+  TEST_ASSERT_EQUAL_UINT32(10, stats.played);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.late);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.rejected);
+  TEST_ASSERT_FALSE(buffer.started());
+}
+
+void test_reorder_within_window(void) {
+  JitterBuffer buffer;
+  _receive(buffer, 0);
+  buffer.Drain();
+  _receive(buffer, 2);
+  _receive(buffer, 3);
+  buffer.Drain();
+  // Held for the one missing before them.
+  _assert_played({0});
+  TEST_ASSERT_EQUAL_UINT32(LIVE_STREAM_JITTER_MS / portTICK_PERIOD_MS, buffer.HoldTicks());
+
+  _advance_ms(LIVE_STREAM_JITTER_MS / 2);
+  _receive(buffer, 1);
+  buffer.Drain();
+  _assert_played({0, 1, 2, 3});
+  TEST_ASSERT_EQUAL_UINT32(portMAX_DELAY, buffer.HoldTicks());
+  TEST_ASSERT_EQUAL_UINT32(0, buffer.Finish().lost);
+}
+
+void test_gap_given_up_after_window(void) {
+  JitterBuffer buffer;
+  _receive(buffer, 0);
+  _receive(buffer, 2);
+  buffer.Drain();
+  _assert_played({0});
+
+  _advance_ms(LIVE_STREAM_JITTER_MS / 2);
+  TEST_ASSERT_EQUAL_UINT32(LIVE_STREAM_JITTER_MS / 2 / portTICK_PERIOD_MS, buffer.HoldTicks());
+  buffer.Drain();
+  _assert_played({0});
+
+  _advance_ms(LIVE_STREAM_JITTER_MS / 2);
+  TEST_ASSERT_EQUAL_UINT32(0, buffer.HoldTicks());
+  buffer.Drain();
+  _assert_played({0, 2});
+
+  // The missing datagram arrives too late.
+  _receive(buffer, 1);
+  buffer.Drain();
+  _assert_played({0, 2});
+
+  StreamStats stats = buffer.Finish();
+  TEST_ASSERT_EQUAL_UINT32(2, stats.played);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.late);
+}
+
+void test_duplicates(void) {
+  JitterBuffer buffer;
+  _receive(buffer, 0);
+  buffer.Drain();
+  _receive(buffer, 0);
+  // Held, then duplicated while held.
+  _receive(buffer, 2);
+  _receive(buffer, 2);
+  buffer.Drain();
+  _assert_played({0});
+
+  StreamStats stats = buffer.Finish();
+  // Anything held is played at the end of the stream.
+  _assert_played({0, 2});
+  TEST_ASSERT_EQUAL_UINT32(2, stats.played);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.late);
+}
+
+void test_far_ahead(void) {
+  JitterBuffer buffer;
+  _receive(buffer, 0);
+  buffer.Drain();
+  _receive(buffer, 2);
+  // Beyond the reorder slots, stop waiting for the gaps, and play what is held.
+  _receive(buffer, 2 + LIVE_STREAM_SLOTS + 1);
+  _assert_played({0, 2});
+  buffer.Drain();
+  _assert_played({0, 2, 2 + LIVE_STREAM_SLOTS + 1});
+
+  StreamStats stats = buffer.Finish();
+  TEST_ASSERT_EQUAL_UINT32(3, stats.played);
+  TEST_ASSERT_EQUAL_UINT32(1 + LIVE_STREAM_SLOTS, stats.lost);
+}
+
+void test_far_ahead_of_undrained(void) {
+  JitterBuffer buffer;
+  _receive(buffer, 0);
+  // Shares the reorder slot with the datagram held before it, which is played to make room.
+  _receive(buffer, LIVE_STREAM_SLOTS);
+  _assert_played({0});
+  buffer.Drain();
+  _assert_played({0});
+  _advance_ms(LIVE_STREAM_JITTER_MS);
+  buffer.Drain();
+  _assert_played({0, LIVE_STREAM_SLOTS});
+
+  StreamStats stats = buffer.Finish();
+  TEST_ASSERT_EQUAL_UINT32(2, stats.played);
+  TEST_ASSERT_EQUAL_UINT32(LIVE_STREAM_SLOTS - 1, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.late);
+}
+
+void test_sequence_wraps(void) {
+  JitterBuffer buffer;
+  _receive(buffer, 65534);
+  buffer.Drain();
+  _receive(buffer, 0);
+  _receive(buffer, 65535);
+  buffer.Drain();
+  _receive(buffer, 1);
+  buffer.Drain();
+  _assert_played({65534, 65535, 0, 1});
+
+  StreamStats stats = buffer.Finish();
+  TEST_ASSERT_EQUAL_UINT32(4, stats.played);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.late);
+}
+
+void test_refused(void) {
+  JitterBuffer buffer;
+  refuse_live_ = true;
+  _receive(buffer, 0);
+  _receive(buffer, 1);
+  buffer.Drain();
+  refuse_live_ = false;
+  _receive(buffer, 2);
+  buffer.Drain();
+  _assert_played({2});
+
+  StreamStats stats = buffer.Finish();
+  TEST_ASSERT_EQUAL_UINT32(1, stats.played);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.rejected);
+}
+
+void test_restart(void) {
+  JitterBuffer buffer;
+  _receive(buffer, 100);
+  buffer.Drain();
+  buffer.Finish();
+
+  // A new stream may start from any sequence.
+  _receive(buffer, 7);
+  buffer.Drain();
+  _assert_played({100, 7});
+  StreamStats stats = buffer.Finish();
+  TEST_ASSERT_EQUAL_UINT32(1, stats.played);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.late);
+}
+
+void test_valid_datagram(void) {
+  uint8_t data[LIVE_DATAGRAM_LIMIT + 1] = {'T', 'W', 'L', 'S', 0, 0, 1, 0};
+  TEST_ASSERT_TRUE(_valid_datagram(data, LIVE_HEADER_SIZE + SHOW_KEYFRAME_SIZE));
+  TEST_ASSERT_FALSE(_valid_datagram(data, LIVE_HEADER_SIZE + SHOW_KEYFRAME_SIZE - 1));
+  TEST_ASSERT_FALSE(_valid_datagram(data, LIVE_HEADER_SIZE - 1));
+
+  data[6] = 0;
+  TEST_ASSERT_TRUE(_valid_datagram(data, LIVE_HEADER_SIZE));
+  data[6] = LIVE_STREAM_MAX_KEYFRAMES + 1;
+  TEST_ASSERT_FALSE(_valid_datagram(data, LIVE_DATAGRAM_LIMIT + SHOW_KEYFRAME_SIZE));
+
+  data[6] = 0;
+  data[0] = 't';
+  TEST_ASSERT_FALSE(_valid_datagram(data, LIVE_HEADER_SIZE));
+}
+
+}  // namespace twilight
+}  // namespace zw::esp8266::app
+
+void setUp(void) {
+  zw::esp8266::app::twilight::played_.clear();
+  zw::esp8266::app::twilight::refuse_live_ = false;
+}
+void tearDown(void) {}
+
+int main(int argc, char** argv) {
+  using namespace zw::esp8266::app::twilight;
+  UNITY_BEGIN();
+  RUN_TEST(test_in_order);
+  RUN_TEST(test_reorder_within_window);
+  RUN_TEST(test_gap_given_up_after_window);
+  RUN_TEST(test_duplicates);
+  RUN_TEST(test_far_ahead);
+  RUN_TEST(test_far_ahead_of_undrained);
+  RUN_TEST(test_sequence_wraps);
+  RUN_TEST(test_refused);
+  RUN_TEST(test_restart);
+  RUN_TEST(test_valid_datagram);
+  return UNITY_END();
+}
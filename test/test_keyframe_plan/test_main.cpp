@@ -0,0 +1,224 @@
+// Host-side unit tests of the keyframe planner.
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include <unity.h>
+
+#include "TWiLight/KeyframePlan.cpp"
+
+namespace zw::esp8266::app::twilight {
+
+// Provided by `KeyframeShow.cpp`, which is not part of the test.
+esp_err_t StreamKeyframeShow(const char* file_name, const KeyframeSink& sink) {
+  return ESP_ERR_NOT_FOUND;
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Reference HSV to RGB conversion of full saturation, in floating point.
+LS::RGB888 _hue_color_float(float hue, float value) {
+  hue = fmodf(hue, 360.0f) / 60.0f;
+  const float x = 1.0f - fabsf(fmodf(hue, 2.0f) - 1.0f);
+  float r = 0, g = 0, b = 0;
+  switch ((int)hue) {
+    case 0:
+      r = 1, g = x;
+      break;
+    case 1:
+      r = x, g = 1;
+      break;
+    case 2:
+      g = 1, b = x;
+      break;
+    case 3:
+      g = x, b = 1;
+      break;
+    case 4:
+      r = x, b = 1;
+      break;
+    default:
+      r = 1, b = x;
+  }
+  return {(uint8_t)lroundf(r * value), (uint8_t)lroundf(g * value), (uint8_t)lroundf(b * value)};
+}
+
+int _channel_error(uint8_t a, uint8_t b) { return a > b ? a - b : b - a; }
+
+std::vector<Keyframe> _plan(const Config::Transition& transition, esp_err_t expected = ESP_OK) {
+  std::vector<Keyframe> keyframes;
+  TEST_ASSERT_EQUAL(expected, PlanTransition(transition, [&keyframes](const Keyframe& keyframe) {
+                      keyframes.push_back(keyframe);
+                      return ESP_OK;
+                    }));
+  return keyframes;
+}
+
+void _assert_keyframe(const Keyframe& expected, const Keyframe& actual) {
+  TEST_ASSERT_EQUAL((int)expected.type, (int)actual.type);
+  TEST_ASSERT_EQUAL_UINT32(expected.duration_ms, actual.duration_ms);
+  TEST_ASSERT_TRUE(expected.color == actual.color);
+  if (expected.type == Keyframe::Type::COLOR_WIPE) {
+    TEST_ASSERT_EQUAL_UINT16(expected.blade_width, actual.blade_width);
+    TEST_ASSERT_EQUAL((int)expected.direction, (int)actual.direction);
+  }
+}
+
+void _assert_plan(const std::vector<Keyframe>& expected, const std::vector<Keyframe>& actual) {
+  TEST_ASSERT_EQUAL_size_t(expected.size(), actual.size());
+  for (size_t idx = 0; idx < expected.size(); ++idx) {
+    _assert_keyframe(expected[idx], actual[idx]);
+  }
+}
+
+}  // namespace
+
+void test_hue_color_error_bound(void) {
+  int max_error = 0;
+  for (uint32_t hue = 0; hue < 360; ++hue) {
+    for (uint32_t value = 0; value <= 255; ++value) {
+      const LS::RGB888 color = hue_color(hue, value);
+      const LS::RGB888 expected = _hue_color_float(hue, value);
+      max_error = std::max({max_error, _channel_error(color.r, expected.r),
+                            _channel_error(color.g, expected.g),
+                            _channel_error(color.b, expected.b)});
+    }
+  }
+  printf("Hue color: max channel error %d\n", max_error);
+  TEST_ASSERT_LESS_OR_EQUAL_INT(2, max_error);
+
+  // The primaries, and full brightness, are exact.
+  TEST_ASSERT_TRUE(hue_color(0, 255) == (LS::RGB888{0xFF, 0, 0}));
+  TEST_ASSERT_TRUE(hue_color(120, 255) == (LS::RGB888{0, 0xFF, 0}));
+  TEST_ASSERT_TRUE(hue_color(240, 255) == (LS::RGB888{0, 0, 0xFF}));
+  TEST_ASSERT_TRUE(hue_color(360 + 120, 255) == (LS::RGB888{0, 0xFF, 0}));
+  TEST_ASSERT_TRUE(hue_color(60, 0) == (LS::RGB888{0, 0, 0}));
+}
+
+void test_plan_uniform_color(void) {
+  Config::Transition transition = {};
+  transition.type = Config::Transition::Type::UNIFORM_COLOR;
+  transition.duration_ms = 1500;
+  transition.uniform_color.color = {0x12, 0x34, 0x56};
+  _assert_plan({{.type = Keyframe::Type::UNIFORM_COLOR,
+                 .duration_ms = 1500,
+                 .color = {0x12, 0x34, 0x56}}},
+               _plan(transition));
+}
+
+void test_plan_color_wipe(void) {
+  using Direction = Config::Transition::ColorWipe::Direction;
+  Config::Transition transition = {};
+  transition.type = Config::Transition::Type::COLOR_WIPE;
+  transition.duration_ms = 2500;
+  transition.color_wipe = {Direction::RightToLeft, 200, {0xFF, 0x80, 0}};
+  _assert_plan({{.type = Keyframe::Type::COLOR_WIPE,
+                 .duration_ms = 2500,
+                 .color = {0xFF, 0x80, 0},
+                 .blade_width = 200,
+                 .direction = Direction::RightToLeft}},
+               _plan(transition));
+}
+
+// Half the hue circle, starting on a sector boundary at full intensity.
+void test_plan_color_wheel_aligned(void) {
+  Config::Transition transition = {};
+  transition.type = Config::Transition::Type::COLOR_WHEEL;
+  transition.duration_ms = 4000;
+  transition.color_wheel = {0, 500, 100};
+  _assert_plan(
+      {
+          {.type = Keyframe::Type::UNIFORM_COLOR, .duration_ms = 1000, .color = {0xFF, 0, 0}},
+          {.type = Keyframe::Type::UNIFORM_COLOR, .duration_ms = 1000, .color = {0xFF, 0xFF, 0}},
+          {.type = Keyframe::Type::UNIFORM_COLOR, .duration_ms = 1000, .color = {0, 0xFF, 0}},
+          {.type = Keyframe::Type::UNIFORM_COLOR, .duration_ms = 1000, .color = {0, 0xFF, 0xFF}},
+      },
+      _plan(transition));
+}
+
+// A quarter of the hue circle, starting mid-sector at half intensity.
+void test_plan_color_wheel_unaligned(void) {
+  Config::Transition transition = {};
+  transition.type = Config::Transition::Type::COLOR_WHEEL;
+  transition.duration_ms = 1000;
+  transition.color_wheel = {30, 250, 50};
+  _assert_plan(
+      {
+          {.type = Keyframe::Type::UNIFORM_COLOR, .duration_ms = 400, .color = {127, 63, 0}},
+          {.type = Keyframe::Type::UNIFORM_COLOR, .duration_ms = 200, .color = {127, 127, 0}},
+          {.type = Keyframe::Type::UNIFORM_COLOR, .duration_ms = 400, .color = {0, 127, 0}},
+      },
+      _plan(transition));
+  TEST_ASSERT_TRUE(color_wheel_end(transition.color_wheel) == (LS::RGB888{0, 127, 0}));
+}
+
+// Keyframe times are derived from the total, so they always add up to the duration.
+void test_plan_color_wheel_total(void) {
+  Config::Transition transition = {};
+  transition.type = Config::Transition::Type::COLOR_WHEEL;
+  transition.duration_ms = 9999;
+  for (uint16_t wheel_width = 0; wheel_width <= 1000; wheel_width += 7) {
+    transition.color_wheel = {17, wheel_width, 100};
+    uint32_t total_ms = 0;
+    for (const Keyframe& keyframe : _plan(transition)) total_ms += keyframe.duration_ms;
+    TEST_ASSERT_EQUAL_UINT32(transition.duration_ms, total_ms);
+  }
+}
+
+// Shows are streamed from storage, the planner only passes the error through.
+void test_plan_keyframe_show(void) {
+  Config::Transition transition = {};
+  transition.type = Config::Transition::Type::KEYFRAME_SHOW;
+  transition.duration_ms = 1000;
+  strcpy(transition.keyframe_show.file, "sunset.twks");
+  TEST_ASSERT_EQUAL_size_t(0, _plan(transition, ESP_ERR_NOT_FOUND).size());
+}
+
+// A full-strip frame of a hue gradient, with the table against the float reference.
+void test_bench_hue_color(void) {
+  static constexpr size_t PIXELS = 1024;
+  static constexpr int ROUNDS = 200;
+  std::vector<LS::RGB888> frame(PIXELS);
+  auto ns_per_pixel = [&](auto color_of) {
+    uint32_t checksum = 0;
+    const auto start = Clock::now();
+    for (int round = 0; round < ROUNDS; ++round) {
+      for (size_t pixel = 0; pixel < PIXELS; ++pixel) {
+        frame[pixel] = color_of(round + pixel * 360 / PIXELS, 200);
+      }
+      checksum += frame[round % PIXELS].r;
+    }
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    TEST_ASSERT_GREATER_THAN_UINT32(0, checksum);
+    return elapsed.count() / ROUNDS / PIXELS;
+  };
+  const double float_ns =
+      ns_per_pixel([](uint32_t hue, uint8_t value) { return _hue_color_float(hue, value); });
+  const double table_ns = ns_per_pixel(hue_color);
+  printf("Hue color: float %5.1f ns, table %5.1f ns per pixel\n", float_ns, table_ns);
+}
+
+}  // namespace zw::esp8266::app::twilight
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int main(int argc, char** argv) {
+  using namespace zw::esp8266::app::twilight;
+  UNITY_BEGIN();
+  RUN_TEST(test_hue_color_error_bound);
+  RUN_TEST(test_plan_uniform_color);
+  RUN_TEST(test_plan_color_wipe);
+  RUN_TEST(test_plan_color_wheel_aligned);
+  RUN_TEST(test_plan_color_wheel_unaligned);
+  RUN_TEST(test_plan_color_wheel_total);
+  RUN_TEST(test_plan_keyframe_show);
+  RUN_TEST(test_bench_hue_color);
+  return UNITY_END();
+}
@@ -0,0 +1,139 @@
+// Host-side unit tests of resolving the requested byte range of a response body.
+
+#include <unity.h>
+
+#include "AppHTTPD/Utils.cpp"
+
+namespace zw::esp8266::app::httpd {
+
+namespace {
+
+inline constexpr size_t BODY_SIZE = 1000;
+inline constexpr char ETAG[] = "\"3e8-1234\"";
+
+// Resolve the range of `BODY_SIZE` bytes requested with the given headers.
+utils::DataOrError<BodyRange> _resolve(const char* range, const char* if_range = nullptr,
+                                       const char* etag = ETAG, size_t size = BODY_SIZE) {
+  httpd_req_t req = {};
+  if (range != nullptr) req.headers[HTTP_HEADER_RANGE] = range;
+  if (if_range != nullptr) req.headers[HTTP_HEADER_IF_RANGE] = if_range;
+  return resolve_range(&req, size, etag);
+}
+
+void _assert_partial(size_t start, size_t length, const utils::DataOrError<BodyRange>& range) {
+  TEST_ASSERT_TRUE(range);
+  TEST_ASSERT_TRUE(range->partial);
+  TEST_ASSERT_EQUAL_size_t(start, range->start);
+  TEST_ASSERT_EQUAL_size_t(length, range->length);
+}
+
+void _assert_whole(const utils::DataOrError<BodyRange>& range, size_t size = BODY_SIZE) {
+  TEST_ASSERT_TRUE(range);
+  TEST_ASSERT_FALSE(range->partial);
+  TEST_ASSERT_EQUAL_size_t(0, range->start);
+  TEST_ASSERT_EQUAL_size_t(size, range->length);
+}
+
+void _assert_unsatisfiable(const utils::DataOrError<BodyRange>& range) {
+  TEST_ASSERT_FALSE(range);
+  TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_SIZE, range.error());
+}
+
+}  // namespace
+
+void test_no_range(void) {
+  _assert_whole(_resolve(nullptr));
+  _assert_whole(_resolve(""));
+  _assert_whole(_resolve("items=0-10"));
+  _assert_whole(_resolve("0-10"));
+}
+
+void test_bounded_range(void) {
+  _assert_partial(0, 1, _resolve("bytes=0-0"));
+  _assert_partial(100, 100, _resolve("bytes=100-199"));
+  _assert_partial(0, BODY_SIZE, _resolve("bytes=0-999"));
+  _assert_partial(999, 1, _resolve("bytes=999-999"));
+}
+
+void test_bounded_range_clamped(void) {
+  _assert_partial(900, 100, _resolve("bytes=900-1000"));
+  _assert_partial(500, 500, _resolve("bytes=500-99999"));
+}
+
+void test_open_range(void) {
+  _assert_partial(0, BODY_SIZE, _resolve("bytes=0-"));
+  _assert_partial(400, 600, _resolve("bytes=400-"));
+  _assert_partial(999, 1, _resolve("bytes=999-"));
+}
+
+void test_suffix_range(void) {
+  _assert_partial(900, 100, _resolve("bytes=-100"));
+  _assert_partial(999, 1, _resolve("bytes=-1"));
+  // Longer than the body, so all of it.
+  _assert_partial(0, BODY_SIZE, _resolve("bytes=-5000"));
+}
+
+void test_unsatisfiable(void) {
+  _assert_unsatisfiable(_resolve("bytes=1000-"));
+  _assert_unsatisfiable(_resolve("bytes=1000-2000"));
+  _assert_unsatisfiable(_resolve("bytes=-0"));
+  _assert_unsatisfiable(_resolve("bytes=0-", nullptr, ETAG, 0));
+  _assert_unsatisfiable(_resolve("bytes=-10", nullptr, ETAG, 0));
+}
+
+void test_multiple_ranges(void) {
+  _assert_whole(_resolve("bytes=0-9,20-29"));
+  _assert_whole(_resolve("bytes=0-9, -10"));
+}
+
+void test_malformed(void) {
+  _assert_whole(_resolve("bytes="));
+  _assert_whole(_resolve("bytes=-"));
+  _assert_whole(_resolve("bytes=10"));
+  _assert_whole(_resolve("bytes=a-b"));
+  _assert_whole(_resolve("bytes=10-x"));
+  _assert_whole(_resolve("bytes=10-20x"));
+  _assert_whole(_resolve("bytes= 10-20"));
+  _assert_whole(_resolve("bytes=10--20"));
+  _assert_whole(_resolve("bytes=-+10"));
+  // Reversed
+  _assert_whole(_resolve("bytes=20-10"));
+}
+
+void test_if_range(void) {
+  _assert_partial(0, 10, _resolve("bytes=0-9", ETAG));
+  // Changed since the client cached it
+  _assert_whole(_resolve("bytes=0-9", "\"3e8-5678\""));
+  // No validator to compare against
+  _assert_whole(_resolve("bytes=0-9", ETAG, nullptr));
+  // Without `If-Range`, the range stands even without a validator.
+  _assert_partial(0, 10, _resolve("bytes=0-9", nullptr, nullptr));
+}
+
+void test_if_range_weak(void) {
+  const char weak_etag[] = "W/\"3e8-1234\"";
+  _assert_whole(_resolve("bytes=0-9", weak_etag, weak_etag));
+  _assert_whole(_resolve("bytes=0-9", weak_etag, ETAG));
+  _assert_partial(0, 10, _resolve("bytes=0-9", nullptr, weak_etag));
+}
+
+}  // namespace zw::esp8266::app::httpd
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int main(int argc, char** argv) {
+  using namespace zw::esp8266::app::httpd;
+  UNITY_BEGIN();
+  RUN_TEST(test_no_range);
+  RUN_TEST(test_bounded_range);
+  RUN_TEST(test_bounded_range_clamped);
+  RUN_TEST(test_open_range);
+  RUN_TEST(test_suffix_range);
+  RUN_TEST(test_unsatisfiable);
+  RUN_TEST(test_multiple_ranges);
+  RUN_TEST(test_malformed);
+  RUN_TEST(test_if_range);
+  RUN_TEST(test_if_range_weak);
+  return UNITY_END();
+}
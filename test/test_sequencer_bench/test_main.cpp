@@ -0,0 +1,314 @@
+// Host-side benchmarks of the event sequencer.
+// The timings are only reported, not asserted; each benchmark first checks that the
+// variants under comparison agree.
+
+#include <stdio.h>
+#include <time.h>
+
+#include <chrono>
+#include <set>
+
+#include <unity.h>
+
+#include "TWiLight/EventSequencer.cpp"
+
+namespace zw::esp8266::app::twilight {
+
+// Provided by `Config.cpp`, which is not part of the test.
+std::string print_time(uint16_t time) {
+  return utils::DataBuf(8).PrintTo("%02d:%02d", time / 60, time % 60);
+}
+std::string print_event(const Config::Event& event) { return "event"; }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+inline constexpr uint16_t MINUTES_IN_A_DAY = 24 * 60;
+
+// Deterministic pseudo-random numbers, so that runs are comparable.
+uint32_t _random(uint32_t& state) {
+  state = state * 1664525 + 1013904223;
+  return state >> 8;
+}
+
+// A mix of daily and weekly events, a quarter of them without end time.
+Config::EventsList _make_events(size_t count) {
+  Config::EventsList events(count);
+  uint32_t state = count;
+  for (Config::Event& event : events) {
+    Config::Event::TimeRange range = {};
+    range.start = _random(state) % MINUTES_IN_A_DAY;
+    range.has_end = _random(state) % 4 != 0;
+    if (range.has_end) range.end = (range.start + 1 + _random(state) % 240) % MINUTES_IN_A_DAY;
+    if (_random(state) % 2) {
+      event.type = Config::Event::Type::RECURRENT_DAILY;
+      event.daily = range;
+    } else {
+      event.type = Config::Event::Type::RECURRENT_WEEKLY;
+      static_cast<Config::Event::TimeRange&>(event.weekly) = range;
+      event.weekly.days = 1 + _random(state) % 127;
+    }
+    event.transitions = {"bench"};
+  }
+  return events;
+}
+
+// The boundaries of a week, as compiled by `EventTimeline::Compile()`.
+std::vector<TimelineBoundary> _week_boundaries(const Config::EventsList& events) {
+  std::vector<TimelineBoundary> boundaries;
+  for (size_t idx = 0; idx < events.size(); ++idx) {
+    const Config::Event& event = events[idx];
+    for (int32_t day = 0; day < DAYS_IN_A_WEEK; ++day) {
+      if (event.type == Config::Event::Type::RECURRENT_DAILY) {
+        _add_time_range(day, event.daily, idx, boundaries);
+      } else if (event.weekly.days & (1 << day)) {
+        _add_time_range(day, event.weekly, idx, boundaries);
+      }
+    }
+  }
+  for (TimelineBoundary& boundary : boundaries) {
+    if (boundary.time >= SECONDS_IN_A_WEEK) boundary.time -= SECONDS_IN_A_WEEK;
+  }
+  std::sort(boundaries.begin(), boundaries.end());
+  return boundaries;
+}
+
+// Sweep the effective event at each boundary time, with the active events kept in a
+// `std::set` ordered by event index, as the sequencer did before the event masks.
+void _sweep_set(const std::vector<TimelineBoundary>& boundaries,
+                std::vector<int16_t>& effective) {
+  struct ActiveEvent {
+    int16_t event_idx;
+    bool open_ended;
+    bool operator<(const ActiveEvent& other) const { return event_idx < other.event_idx; }
+  };
+  std::set<ActiveEvent> active_events;
+
+  effective.clear();
+  for (auto iter = boundaries.begin(); iter != boundaries.end();) {
+    const int32_t time = iter->time;
+    if (iter->type != TimelineBoundary::Type::END) {
+      for (auto active = active_events.begin(); active != active_events.end();) {
+        active = active->open_ended ? active_events.erase(active) : std::next(active);
+      }
+    }
+    for (; iter != boundaries.end() && iter->time == time; ++iter) {
+      active_events.erase({iter->event_idx, false});
+      if (iter->type != TimelineBoundary::Type::END) {
+        active_events.insert(
+            {iter->event_idx, iter->type == TimelineBoundary::Type::START_OPEN_ENDED});
+      }
+    }
+    effective.push_back(active_events.empty() ? EVENT_IDX_UNCONFIGURED
+                                              : active_events.rbegin()->event_idx);
+  }
+}
+
+// Same sweep with the event masks, as in `EventTimeline::_fold()`.
+void _sweep_mask(const std::vector<TimelineBoundary>& boundaries,
+                 std::vector<int16_t>& effective) {
+  EventMask active_events;
+  EventMask open_ended_events;
+
+  effective.clear();
+  for (auto iter = boundaries.begin(); iter != boundaries.end();) {
+    const int32_t time = iter->time;
+    if (iter->type != TimelineBoundary::Type::END) {
+      active_events.Reset(open_ended_events);
+      open_ended_events.Clear();
+    }
+    for (; iter != boundaries.end() && iter->time == time; ++iter) {
+      switch (iter->type) {
+        case TimelineBoundary::Type::START:
+          active_events.Set(iter->event_idx);
+          break;
+        case TimelineBoundary::Type::START_OPEN_ENDED:
+          active_events.Set(iter->event_idx);
+          open_ended_events.Set(iter->event_idx);
+          break;
+        case TimelineBoundary::Type::END:
+          active_events.Reset(iter->event_idx);
+          break;
+      }
+    }
+    effective.push_back(active_events.Highest());
+  }
+}
+
+// A holiday calendar: annual events on distinct dates, most of them all-day.
+Config::EventsList _make_annual_events(size_t count) {
+  Config::EventsList events(count);
+  uint32_t state = count;
+  for (size_t idx = 0; idx < count; ++idx) {
+    Config::Event& event = events[idx];
+    event.type = Config::Event::Type::RECURRENT_ANNUAL;
+    event.annual.start = (_random(state) % 4) ? 0 : _random(state) % MINUTES_IN_A_DAY;
+    event.annual.end = MINUTES_IN_A_DAY - 1;
+    event.annual.has_end = true;
+    // Spread over the year, including the leap day.
+    const int day_of_year = idx * 366 / count;
+    uint8_t month_idx = 0;
+    while (month_idx < 11 && day_of_year >= DAYS_BEFORE_MONTH[month_idx + 1] + (month_idx >= 1))
+      ++month_idx;
+    event.annual.date = {
+        .month_idx = month_idx,
+        .day = static_cast<uint8_t>(day_of_year - DAYS_BEFORE_MONTH[month_idx] -
+                                    (month_idx > 1) + 1),
+    };
+    event.transitions = {"bench"};
+  }
+  return events;
+}
+
+// Day of year from `mktime()`, as the sequencer did before the calendar tables.
+int _day_of_year_mktime(int year, const Config::Event::DayOfYear& date) {
+  struct tm date_tm = {};
+  date_tm.tm_hour = 12;  // Set to mid-day to avoid boundary wrapping
+  date_tm.tm_mday = date.day;
+  date_tm.tm_mon = date.month_idx;
+  date_tm.tm_year = year;
+  date_tm.tm_isdst = -1;
+
+  if (mktime(&date_tm) < 0) return -1;
+  if (date_tm.tm_mday != date.day) return -1;
+  return date_tm.tm_yday;
+}
+
+template <typename Sweep>
+double _ns_per_boundary(Sweep sweep, const std::vector<TimelineBoundary>& boundaries,
+                        std::vector<int16_t>& effective) {
+  static constexpr int ROUNDS = 200;
+  const auto start = Clock::now();
+  for (int round = 0; round < ROUNDS; ++round) sweep(boundaries, effective);
+  const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  return elapsed.count() / ROUNDS / boundaries.size();
+}
+
+}  // namespace
+
+void test_bench_sweep(void) {
+  for (size_t count : {16, 64, 256}) {
+    const Config::EventsList events = _make_events(count);
+    const std::vector<TimelineBoundary> boundaries = _week_boundaries(events);
+
+    std::vector<int16_t> set_effective, mask_effective;
+    _sweep_set(boundaries, set_effective);
+    _sweep_mask(boundaries, mask_effective);
+    TEST_ASSERT_EQUAL_size_t(set_effective.size(), mask_effective.size());
+    for (size_t idx = 0; idx < set_effective.size(); ++idx) {
+      TEST_ASSERT_EQUAL_INT16(set_effective[idx], mask_effective[idx]);
+    }
+
+    const double set_ns = _ns_per_boundary(_sweep_set, boundaries, set_effective);
+    const double mask_ns = _ns_per_boundary(_sweep_mask, boundaries, mask_effective);
+    printf("Sweep %3zu events, %5zu boundaries: set %6.1f ns, mask %6.1f ns per boundary\n",
+           count, boundaries.size(), set_ns, mask_ns);
+  }
+}
+
+void test_bench_annual(void) {
+  static constexpr size_t ANNUAL_EVENTS = MAX_EVENTS;
+  const Config::EventsList events = _make_annual_events(ANNUAL_EVENTS);
+
+  // Each date over a leap year and its neighbors, as placed by the annual expansion.
+  static constexpr int FIRST_YEAR = 2023 - 1900;
+  static constexpr int LAST_YEAR = 2025 - 1900;
+  for (int year = FIRST_YEAR; year <= LAST_YEAR; ++year) {
+    for (const Config::Event& event : events) {
+      TEST_ASSERT_EQUAL_INT(_day_of_year_mktime(year, event.annual.date),
+                            _day_of_year(year, event.annual.date));
+    }
+  }
+  static constexpr int ROUNDS = 100;
+  auto ns_per_date = [&](auto day_of_year) {
+    int checksum = 0;
+    const auto start = Clock::now();
+    for (int round = 0; round < ROUNDS; ++round) {
+      for (int year = FIRST_YEAR; year <= LAST_YEAR; ++year) {
+        for (const Config::Event& event : events) checksum += day_of_year(year, event.annual.date);
+      }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    TEST_ASSERT_NOT_EQUAL(0, checksum);
+    return elapsed.count() / ROUNDS / (LAST_YEAR - FIRST_YEAR + 1) / events.size();
+  };
+  const double mktime_ns = ns_per_date(_day_of_year_mktime);
+  const double table_ns = ns_per_date(_day_of_year);
+  printf("Annual dates: mktime %6.1f ns, tables %6.1f ns per date\n", mktime_ns, table_ns);
+
+  // Every week of a year, which folds all annual events into each.
+  EventTimeline timeline;
+  TEST_ASSERT_EQUAL(ESP_OK, timeline.Compile(events));
+  struct tm time_tm = {};
+  time_tm.tm_year = 2024 - 1900;
+  time_tm.tm_mday = 1;
+  time_tm.tm_hour = 12;
+  time_t time = timegm(&time_tm);
+  static constexpr int WEEKS = 52;
+  size_t configured = 0;
+  const auto start = Clock::now();
+  for (int week = 0; week < WEEKS; ++week, time += SECONDS_IN_A_WEEK) {
+    gmtime_r(&time, &time_tm);
+    auto entry = timeline.Lookup(time_tm);
+    TEST_ASSERT_TRUE(entry);
+    if (entry->event_idx != EVENT_IDX_UNCONFIGURED) ++configured;
+  }
+  const std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+  TEST_ASSERT_GREATER_THAN_size_t(0, configured);
+  printf("Annual fold %zu events: %6.1f us per week\n", ANNUAL_EVENTS, elapsed.count() / WEEKS);
+}
+
+// Fast-forward over a year with a mixed schedule, as the `/simulate` endpoint does.
+void test_bench_fast_forward(void) {
+  for (size_t count : {16, 64, 256}) {
+    Config::EventsList events = _make_events(count - count / 4);
+    Config::EventsList annual_events = _make_annual_events(count / 4);
+    events.insert(events.end(), annual_events.begin(), annual_events.end());
+
+    const auto start = Clock::now();
+    EventTimeline timeline;
+    TEST_ASSERT_EQUAL(ESP_OK, timeline.Compile(events));
+    struct tm time_tm = {};
+    time_tm.tm_year = 2024 - 1900;
+    time_tm.tm_mday = 1;
+    time_t time = timegm(&time_tm);
+    gmtime_r(&time, &time_tm);
+    int64_t local_seconds = get_local_seconds(time_tm);
+    const int64_t end_seconds = local_seconds + 366 * SECONDS_IN_A_DAY;
+    int16_t last_event_idx = EVENT_IDX_UNINITIALIZED;
+    size_t lookups = 0, changes = 0;
+    while (local_seconds < end_seconds) {
+      auto entry = timeline.Lookup(time_tm);
+      TEST_ASSERT_TRUE(entry);
+      TEST_ASSERT_GREATER_THAN_INT64(local_seconds, entry->completion);
+      ++lookups;
+      if (entry->event_idx != last_event_idx) {
+        last_event_idx = entry->event_idx;
+        ++changes;
+      }
+      local_seconds = entry->completion;
+      time_t next_time = local_seconds;
+      gmtime_r(&next_time, &time_tm);
+    }
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    TEST_ASSERT_GREATER_THAN_size_t(count, changes);
+    printf("Fast-forward %3zu events over a year: %6zu changes, %6zu lookups, "
+           "%.2f M lookups/s\n",
+           count, changes, lookups, lookups / elapsed.count() / 1e6);
+  }
+}
+
+}  // namespace zw::esp8266::app::twilight
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int main(int argc, char** argv) {
+  using namespace zw::esp8266::app::twilight;
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_sweep);
+  RUN_TEST(test_bench_annual);
+  RUN_TEST(test_bench_fast_forward);
+  return UNITY_END();
+}
@@ -0,0 +1,122 @@
+"""Stage the data partition with fingerprinted asset references.
+
+Local references to assets (`src` and `href` attributes of HTML pages, `url()` in style
+sheets) under `http/` get a `?v=<digest>` version parameter, where the digest matches the
+content ETag of the served file (see `_hash_asset_etag()` in `Handler_FileServ.cpp`). The
+file server caches such URIs as immutable, and a changed asset gets a new URI.
+
+As a PlatformIO pre-script (`extra_scripts = pre:tools/fingerprint_assets.py`), the data
+directory is staged under the build directory, and the file system image is built from
+the staged copy. The sources in `data/` are never modified.
+
+It can also be run by hand: `python3 tools/fingerprint_assets.py <data dir> <output dir>`
+"""
+
+import hashlib
+import os
+import re
+import shutil
+import sys
+
+HTTP_DIR = "http"
+SERVE_AS_GZ_SUFFIX = "._serve_as_.gz"
+URI_PARAM_VERSION = "v"
+# Half of the MD5 digest, as in the content ETag.
+DIGEST_BYTES = 8
+
+HTML_EXTS = (".htm", ".html")
+CSS_EXTS = (".css",)
+
+HTML_REF_PATTERN = re.compile(r"""(\b(?:src|href)\s*=\s*)(["'])([^"'?#]+)\2""")
+CSS_REF_PATTERN = re.compile(r"""(\burl\(\s*)(["']?)([^"')?#]+)\2(\s*\))""")
+
+
+def _served_path(path):
+    # The compressed variant takes precedence, as in the file server index.
+    gz_path = path + SERVE_AS_GZ_SUFFIX
+    if os.path.isfile(gz_path):
+        return gz_path
+    return path if os.path.isfile(path) else None
+
+
+def _digest(path):
+    with open(path, "rb") as f:
+        return hashlib.md5(f.read()).hexdigest()[:DIGEST_BYTES * 2]
+
+
+def _resolve(http_root, file_path, ref):
+    # Only local references, relative or from the root; pages are never fingerprinted.
+    if ":" in ref or ref.startswith("//") or ref.lower().endswith(HTML_EXTS):
+        return None
+    if ref.startswith("/"):
+        path = os.path.join(http_root, ref.lstrip("/"))
+    else:
+        path = os.path.join(os.path.dirname(file_path), ref)
+    return _served_path(os.path.normpath(path))
+
+
+def _rewrite(http_root, file_path, pattern):
+    with open(file_path, encoding="utf-8") as f:
+        text = f.read()
+    count = 0
+
+    def versioned(match):
+        nonlocal count
+        target = _resolve(http_root, file_path, match.group(3))
+        if target is None:
+            return match.group(0)
+        count += 1
+        ref = f"{match.group(3)}?{URI_PARAM_VERSION}={_digest(target)}"
+        return match.group(1) + match.group(2) + ref + match.group(2) + "".join(
+            match.groups()[3:])
+
+    text = pattern.sub(versioned, text)
+    if count:
+        with open(file_path, "w", encoding="utf-8") as f:
+            f.write(text)
+    return count
+
+
+def _files_with_ext(root, exts):
+    for dir_path, _, file_names in os.walk(root):
+        for file_name in sorted(file_names):
+            # Compressed files are served as-is, and cannot be rewritten.
+            if file_name.lower().endswith(exts) and _served_path(
+                    os.path.join(dir_path, file_name)) == os.path.join(dir_path, file_name):
+                yield os.path.join(dir_path, file_name)
+
+
+def stage_data(data_dir, staged_dir):
+    if os.path.isdir(staged_dir):
+        shutil.rmtree(staged_dir)
+    shutil.copytree(data_dir, staged_dir)
+
+    http_root = os.path.join(staged_dir, HTTP_DIR)
+    if not os.path.isdir(http_root):
+        return 0
+    # Style sheets first, as their digests change with the references they carry.
+    count = 0
+    for file_path in _files_with_ext(http_root, CSS_EXTS):
+        count += _rewrite(http_root, file_path, CSS_REF_PATTERN)
+    for file_path in _files_with_ext(http_root, HTML_EXTS):
+        count += _rewrite(http_root, file_path, HTML_REF_PATTERN)
+    return count
+
+
+def _stage_for_build(env):
+    data_dir = env.subst("$PROJECT_DATA_DIR")
+    staged_dir = os.path.join(env.subst("$BUILD_DIR"), "data")
+    count = stage_data(data_dir, staged_dir)
+    print(f"Fingerprinted {count} asset references in {staged_dir}")
+    env.Replace(PROJECT_DATA_DIR=staged_dir)
+
+
+try:
+    Import("env")  # noqa: F821 (provided by SCons)
+except NameError:
+    if __name__ == "__main__":
+        if len(sys.argv) != 3:
+            sys.exit(f"Usage: {sys.argv[0]} <data dir> <output dir>")
+        print(f"Fingerprinted {stage_data(sys.argv[1], sys.argv[2])} asset references")
+else:
+    _stage_for_build(env)  # noqa: F821
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Compile a JSON keyframe show into a TWiLight show file (TWKS).
+
+The input is a JSON array of keyframes, with the fields named and encoded as in the
+transitions of the TWiLight config:
+
+  [
+    {"type": "uniform-color", "duration_ms": 1000, "color": "#ff8000"},
+    {"type": "color-wipe", "duration_ms": 2000, "color": "#0000ff",
+     "direction": "RtL", "blade_width": "0.2"},
+    {"type": "noop", "duration_ms": 500}
+  ]
+
+The output format is documented in `src/TWiLight/KeyframeShow.hpp`. Upload the
+result to the `/shows/` directory of the storage partition, and reference it by
+name from a `keyframe-show` transition.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+SHOW_MAGIC = b"TWKS"
+SHOW_VERSION = 1
+# Must match `Config::Transition::KeyframeShow::file`, including the terminator.
+SHOW_FILE_NAME_SIZE = 24
+
+KEYFRAME_TYPES = {"noop": 0, "uniform-color": 1, "color-wipe": 2}
+WIPE_DIRECTIONS = {"LtR": 0, "RtL": 1}
+
+U16_MAX = 0xFFFF
+U32_MAX = 0xFFFFFFFF
+
+PERMILLE_PATTERN = re.compile(r"^(\d*)(?:\.(\d*))?$")
+
+
+class ShowError(Exception):
+    pass
+
+
+def _decode_size(value, limit):
+    # Config values are strings, plain numbers are accepted for convenience.
+    if isinstance(value, str) and value.isdigit():
+        value = int(value)
+    if isinstance(value, bool) or not isinstance(value, int) or not 0 <= value <= limit:
+        raise ShowError(f"invalid size {value!r}")
+    return value
+
+
+def _decode_permille(value):
+    # Same as `decode_permille()`: digits beyond the third decimal place are dropped.
+    match = PERMILLE_PATTERN.match(str(value))
+    if not match or not any(match.groups()):
+        raise ShowError(f"invalid fraction {value!r}")
+    whole, fraction = match.group(1), match.group(2) or ""
+    permille = int(whole or "0") * 1000 + int((fraction + "000")[:3])
+    if permille > U16_MAX:
+        raise ShowError(f"fraction {value!r} out of range")
+    return permille
+
+
+def _decode_color(value):
+    if not isinstance(value, str) or len(value) != 7 or value[0] != "#":
+        raise ShowError(f"invalid color {value!r}")
+    try:
+        return bytes.fromhex(value[1:])
+    except ValueError:
+        raise ShowError(f"invalid color {value!r}") from None
+
+
+def _decode_enum(value, names, what):
+    if value not in names:
+        raise ShowError(f"invalid {what} {value!r}, expect one of {', '.join(names)}")
+    return names[value]
+
+
+def encode_keyframe(keyframe):
+    if not isinstance(keyframe, dict):
+        raise ShowError("keyframe not an object")
+    keyframe_type = _decode_enum(keyframe.get("type"), KEYFRAME_TYPES, "type")
+    duration_ms = _decode_size(keyframe.get("duration_ms"), U32_MAX)
+    color = b"\x00\x00\x00"
+    direction = blade_width = 0
+    if keyframe_type != KEYFRAME_TYPES["noop"]:
+        color = _decode_color(keyframe.get("color"))
+    if keyframe_type == KEYFRAME_TYPES["color-wipe"]:
+        direction = _decode_enum(keyframe.get("direction"), WIPE_DIRECTIONS, "direction")
+        blade_width = _decode_permille(keyframe.get("blade_width"))
+    return struct.pack("<BBHI3sx", keyframe_type, direction, blade_width, duration_ms, color)
+
+
+def compile_show(keyframes):
+    if not isinstance(keyframes, list):
+        raise ShowError("show not an array of keyframes")
+    if not 0 < len(keyframes) <= U16_MAX:
+        raise ShowError(f"expect 1 to {U16_MAX} keyframes, got {len(keyframes)}")
+
+    result = bytearray(struct.pack("<4sBxH", SHOW_MAGIC, SHOW_VERSION, len(keyframes)))
+    for idx, keyframe in enumerate(keyframes):
+        try:
+            result += encode_keyframe(keyframe)
+        except ShowError as e:
+            raise ShowError(f"keyframe #{idx}: {e}") from None
+    return bytes(result)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="JSON keyframe show")
+    parser.add_argument("output", nargs="?",
+                        help="show file to write (default: input name with `.twks`)")
+    args = parser.parse_args()
+
+    output = args.output or os.path.splitext(args.input)[0] + ".twks"
+    if len(os.path.basename(output)) >= SHOW_FILE_NAME_SIZE:
+        print(f"Show file name must be shorter than {SHOW_FILE_NAME_SIZE} characters",
+              file=sys.stderr)
+        return 1
+
+    try:
+        with open(args.input, encoding="utf-8") as f:
+            keyframes = json.load(f)
+        show = compile_show(keyframes)
+    except (OSError, json.JSONDecodeError, ShowError) as e:
+        print(f"{args.input}: {e}", file=sys.stderr)
+        return 1
+
+    with open(output, "wb") as f:
+        f.write(show)
+    total_ms = sum(struct.unpack_from("<I", show, 8 + 12 * i + 4)[0]
+                   for i in range(len(keyframes)))
+    print(f"{output}: {len(keyframes)} keyframes over {total_ms} ms")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())